@@ -26,18 +26,35 @@
 
 #include "Display.h"
 #include "Io.h"
+#include "Log.h"
+#include "Output.h"
+#include "SpiLock.h"
 #include "config.h"
 
 
 void setup() {
-    #if LOG >= 1
+    // When streaming is enabled, the logs share the serial port with the stream
+    #if LEDS_SERIAL_STREAMING == 1
+        Serial.begin(LEDS_SERIAL_BAUD);
+    #elif LOG >= 1
         Serial.begin(38400);
-        Serial.println(F("AtmoLight"));
+    #endif
+
+    #if LOG >= 1
+        Log::Write(LogId::Boot);
     #endif
 
     pinMode(13, OUTPUT);
     digitalWrite(13, LOW);
 
+    #if LEDS_CLIP == 1
+        SpiLock::Init();
+    #endif
+
+    #if LEDS_DOUBLE_BUFFER == 1
+        Output::Init();
+    #endif
+
     // The Display's Task method is running in background
     // You just have to call one of the static methods to trigger a light effect
     xTaskCreate(
@@ -57,6 +74,30 @@ void setup() {
         ,  2
         ,  NULL
     );
+
+    // The frames are sent to the leds as soon as they are rendered
+    #if LEDS_DOUBLE_BUFFER == 1
+        xTaskCreate(
+          Output::Task
+            ,  NULL
+            ,  128
+            ,  NULL
+            ,  3
+            ,  NULL
+        );
+    #endif
+
+    // The logs are sent in background, when the other tasks are idle
+    #if LOG >= 1
+        xTaskCreate(
+          Log::Task
+            ,  NULL
+            ,  96
+            ,  NULL
+            ,  1
+            ,  NULL
+        );
+    #endif
 }
 
 void loop() {
@@ -0,0 +1,187 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#if LEDS_CLIP == 1
+
+#include <SD.h>
+#define FASTLED_INTERNAL
+#include <FastLED.h>
+
+#include "ClipReader.h"
+
+#define CLIP_VERSION 1
+#define CLIP_HEADER_SIZE 10
+
+
+bool ClipReader::Open(byte number) {
+    char name[10];
+    byte header[CLIP_HEADER_SIZE];
+
+    Close();
+
+    if (!_sdStarted) {
+        _sdStarted = SD.begin(CLIP_SD_PIN);
+        if (!_sdStarted)
+            return false;
+    }
+
+    strcpy_P(name, PSTR("CLIP0.ALC"));
+    name[4] = '0' + number % CLIP_MAX_NUMBER;
+    _file = SD.open(name, FILE_READ);
+    if (!_file)
+        return false;
+
+    if (!_read(header, CLIP_HEADER_SIZE) || header[0] != 'A' || header[1] != 'L' || header[2] != 'C' || header[3] != CLIP_VERSION) {
+        Close();
+        return false;
+    }
+
+    _leds = header[4] | header[5] << 8;
+    _period = header[6] | header[7] << 8;
+    _frames = header[8] | header[9] << 8;
+    _frame = 0;
+
+    if (_leds == 0 || _frames == 0) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void ClipReader::Close() {
+    if (_file)
+        _file.close();
+
+    _chunkLength = 0;
+    _chunkPosition = 0;
+}
+
+bool ClipReader::IsOpen() {
+    return _file;
+}
+
+uint16_t ClipReader::GetPeriod() {
+    return _period;
+}
+
+bool ClipReader::ReadFrame(CRGB* leds, uint16_t count) {
+    byte color[3];
+    byte op;
+
+    // Loop back to the first frame
+    if (_frame >= _frames) {
+        _frame = 0;
+        _chunkLength = 0;
+        _chunkPosition = 0;
+        if (!_file.seek(CLIP_HEADER_SIZE)) {
+            Close();
+            return false;
+        }
+    }
+
+    for (uint16_t led = 0; led < _leds; ) {
+        if (!_read(&op, 1)) {
+            Close();
+            return false;
+        }
+
+        byte length = (op & 0x3F) + 1;
+
+        switch (op & 0xC0) {
+            case CLIP_OP_SKIP:
+                break;
+
+            case CLIP_OP_RUN:
+                if (!_read(color, 3)) {
+                    Close();
+                    return false;
+                }
+                for (byte i = 0; i < length && led + i < count; i++)
+                    leds[led + i] = CRGB(color[0], color[1], color[2]);
+                break;
+
+            case CLIP_OP_LITERAL:
+                for (byte i = 0; i < length; i++) {
+                    // CRGB is 3 bytes (r, g, b) just like the file, so the colors are read in place
+                    if (!_read(led + i < count ? leds[led + i].raw : color, 3)) {
+                        Close();
+                        return false;
+                    }
+                }
+                break;
+
+            default:
+                Close();
+                return false;
+        }
+
+        led += length;
+    }
+
+    _frame++;
+
+    return true;
+}
+
+bool ClipReader::_read(byte* data, byte length) {
+    for (byte i = 0; i < length; i++) {
+        if (_chunkPosition >= _chunkLength) {
+            int read = _file.read(_chunk, CLIP_CHUNK_SIZE);
+            if (read <= 0)
+                return false;
+
+            _chunkLength = read;
+            _chunkPosition = 0;
+        }
+
+        data[i] = _chunk[_chunkPosition++];
+    }
+
+    return true;
+}
+
+File ClipReader::_file;
+
+bool ClipReader::_sdStarted = false;
+
+uint16_t ClipReader::_leds = 0;
+
+uint16_t ClipReader::_period = 0;
+
+uint16_t ClipReader::_frames = 0;
+
+uint16_t ClipReader::_frame = 0;
+
+byte ClipReader::_chunk[CLIP_CHUNK_SIZE];
+
+byte ClipReader::_chunkLength = 0;
+
+byte ClipReader::_chunkPosition = 0;
+
+#endif
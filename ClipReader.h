@@ -0,0 +1,125 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <SD.h>
+#define FASTLED_INTERNAL
+#include <FastLED.h>
+
+// Chip select pin of the SD card on the Ethernet shield
+#define CLIP_SD_PIN 4
+
+// Number of bytes read from the card at once
+#define CLIP_CHUNK_SIZE 32
+
+// Clips are named CLIP0.ALC to CLIP9.ALC
+#define CLIP_MAX_NUMBER 10
+
+/*
+ * Clip file format (all numbers are little endian):
+ *
+ * Header (10 bytes):
+ *   "ALC", version (1), number of leds (2 bytes), time between frames in ms (2 bytes), number of frames (2 bytes)
+ *
+ * Then every frame is a list of operations, until all the leds are covered.
+ * An operation is one byte: the 2 upper bits give its type, the 6 lower bits the number of leds minus one.
+ *   00 Skip: the leds keep the color of the previous frame
+ *   01 Run: the leds take the color given by the next 3 bytes (r, g, b)
+ *   10 Literal: every led takes the color of the next 3 bytes
+ * The first frame must not skip any led, so the clip can loop back to it.
+ *
+ * Clips are made with tools/clip_encode.py
+ */
+#define CLIP_OP_SKIP 0x00
+#define CLIP_OP_RUN 0x40
+#define CLIP_OP_LITERAL 0x80
+
+
+/**
+ * Plays animation clips from the SD card
+ * The frames are read in small chunks and decoded directly into the leds.
+ */
+class ClipReader {
+public:
+    /**
+     * Open a clip. Starts the SD card if needed.
+     * @param number Number of the clip (CLIPn.ALC)
+     * @return false if the clip is missing or invalid
+     */
+    static bool Open(byte number);
+
+    /**
+     * Close the current clip
+     */
+    static void Close();
+
+    /**
+     * @return true if a clip is open
+     */
+    static bool IsOpen();
+
+    /**
+     * @return Time between two frames of the current clip, in milliseconds
+     */
+    static uint16_t GetPeriod();
+
+    /**
+     * Decode the next frame. Goes back to the first frame after the last one.
+     * @param leds Leds to update
+     * @param count Number of leds. Extra leds of the clip are ignored.
+     * @return false if the clip is corrupted. It is then closed.
+     */
+    static bool ReadFrame(CRGB* leds, uint16_t count);
+
+private:
+    static File _file;
+
+    static bool _sdStarted;
+
+    /**
+     * Header values of the current clip
+     */
+    static uint16_t _leds;
+    static uint16_t _period;
+    static uint16_t _frames;
+
+    /**
+     * Number of the next frame
+     */
+    static uint16_t _frame;
+
+    /**
+     * Bytes read from the card and not decoded yet
+     */
+    static byte _chunk[CLIP_CHUNK_SIZE];
+    static byte _chunkLength;
+    static byte _chunkPosition;
+
+    /**
+     * Read bytes from the current clip, through the chunk
+     * @return false at the end of the file
+     */
+    static bool _read(byte* data, byte length);
+};
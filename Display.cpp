@@ -29,55 +29,153 @@
 #include <FastLED.h>
 
 #include "Display.h"
+#include "Log.h"
+#include "Matrix.h"
 #include "config.h"
 
+#if LEDS_SERIAL_STREAMING == 1
+    #include "SerialStream.h"
+#endif
+
+#if LEDS_AUDIO == 1
+    #include "Spectrum.h"
+#endif
+
+#if LEDS_PROGRAM == 1
+    #include "Vm.h"
+#endif
+
+#if LEDS_CLIP == 1
+    #include "ClipReader.h"
+    #include "SpiLock.h"
+#endif
+
+#if IO_TRACE == 1
+    #include "Trace.h"
+#endif
+
+#if LEDS_DOUBLE_BUFFER == 1
+    #include "Output.h"
+#endif
+
 // Arbitrary byte sequence used to determine if the EEPROM have been written in the past
 #define EEPROM_MAGIC_NUMBER 0b0110100010110110
 
+// Hue difference between two neighbour pixels of the rainbow
+#define RAINBOW_DELTA (LEDS_NUMBER < 256 ? 255 / LEDS_NUMBER : 1)
+
+// Time for the first wave of Aurora to move by one pixel, in milliseconds (0.1 rad per pixel at 0.0005 rad/ms)
+#define AURORA_STEP_PERIOD 200
+
 CRGB strip[LEDS_NUMBER];
 
+#if LOG >= 2
+    bool firstFrameShown = false; // Used to measure the boot time
+#endif
+
+// Colors of the two waves of Fire and Aurora at full brightness.
+// Their hues don't change from one pixel to the other, so they are converted once and only dimmed per pixel.
+CRGB waveColor1;
+CRGB waveColor2;
+
+#if LEDS_KEYFRAMES > 1
+    // Time between two keyframes, in milliseconds
+    #define KEYFRAME_PERIOD ((unsigned long)LEDS_KEYFRAMES * LEDS_DELAY)
+
+    // Frames of Fire or Aurora rendered at the previous and at the next keyframe
+    CRGB keyframeFrom[LEDS_NUMBER];
+    CRGB keyframeTo[LEDS_NUMBER];
+    unsigned long keyframeStart; // Time of the previous keyframe
+#endif
+
+#if LEDS_MATRIX == 0
+    // Brightness of the first wave of Aurora, stored as a ring: pixel i is at (i + step) % LEDS_NUMBER
+    uint8_t auroraWave[LEDS_NUMBER];
+#endif
+
 
 void Display::Task(void *pvParameters) {
     unsigned long prevMillisCountdown = millis(); // Timer used by the remaining time countdown
     
-    FastLED.addLeds<NEOPIXEL, LEDS_PIN>(strip, LEDS_NUMBER);
+    #if LEDS_DOUBLE_BUFFER == 1
+        // The leds are clocked out from a copy of the strip, so that the next frame can be rendered meanwhile
+        FastLED.addLeds<NEOPIXEL, LEDS_PIN>(Output::GetFrame(), LEDS_NUMBER);
+    #else
+        FastLED.addLeds<NEOPIXEL, LEDS_PIN>(strip, LEDS_NUMBER);
+    #endif
     FastLED.setBrightness(LEDS_BRIGHTNESS);
 
     // Set a seed from analog input to get different values each start
     random16_set_seed(analogRead(0));
 
+    #if LEDS_PROGRAM == 1
+        Vm::Restore();
+    #endif
+
     Display::LoadState();
 
     for (;;) {
         while (_remainingTime > 0) {
+            #if IO_TRACE == 1
+                Trace::FrameStart();
+            #endif
+
+            #if LEDS_SERIAL_STREAMING == 1
+                if (_mode != Mode::Adalight)
+                    _detectStream();
+            #endif
+
             if (_mode == Mode::White || _mode == Mode::SolidColor) {
                 if (_isTransiting && strip[0] != _currentColor) {
                     _animateToColor(_currentColor);
-                    FastLED.show();
+                    _show();
                 }
                 else
                     _isTransiting = false;
             }
             else if (_mode == Mode::Pulse) {
                 fill_solid(strip, LEDS_NUMBER, _currentColor & CRGB(CHSV(0, 0, 64 * cos(0.001 * millis()) + 192)));
-                FastLED.show();
+                _show();
             }
             else if (_mode == Mode::Rainbow) {
-                fill_rainbow(strip, LEDS_NUMBER, _reg8_a++, 255 / LEDS_NUMBER);
-                FastLED.show();
-            }
-            else if (_mode == Mode::Fire) {
-                _drawFire();
-                FastLED.show();
+                _drawRainbow();
+                _show();
             }
-            else if (_mode == Mode::Aurora) {
-                _drawAurora();
-                FastLED.show();
+            else if (_mode == Mode::Fire || _mode == Mode::Aurora) {
+                #if LEDS_KEYFRAMES > 1
+                    _drawKeyframes();
+                #else
+                    _drawKeyframe(millis());
+                #endif
+                _show();
             }
             else if (_mode == Mode::Disco) {
                 _drawDisco();
-                FastLED.show();
+                _show();
             }
+            #if LEDS_CLIP == 1
+                else if (_mode == Mode::Clip) {
+                    _drawClip();
+                    _show();
+                }
+            #endif
+            #if LEDS_PROGRAM == 1
+                else if (_mode == Mode::Program) {
+                    _drawProgram();
+                    _show();
+                }
+            #endif
+            #if LEDS_AUDIO == 1
+                else if (_mode == Mode::Audio) {
+                    _drawAudio();
+                    _show();
+                }
+            #endif
+            #if LEDS_SERIAL_STREAMING == 1
+                else if (_mode == Mode::Adalight) {
+                    _drawStream();
+                }
+            #endif
             
             // Countdown
             if (millis() - prevMillisCountdown >= 1000) {
@@ -87,7 +185,7 @@ void Display::Task(void *pvParameters) {
                 // If the time is up
                 if (_remainingTime <= 0) {
                     #if LOG >= 3
-                        Serial.println(F("Time's up"));
+                        Log::Write(LogId::TimesUp);
                     #endif
                     // Switch the lights off
                     SolidColor(0x000000);
@@ -95,15 +193,24 @@ void Display::Task(void *pvParameters) {
             }
 
             // Handle save state request after a short delay
-            if (_saveStateRequested && (millis() - _prevMillisSaveState >= 5000)) {
+            // The Adalight mode is never saved: the saved mode is the one to restore after the stream
+            if (_saveStateRequested && _mode != Mode::Adalight && (millis() - _prevMillisSaveState >= 5000)) {
                 _saveStateRequested = false;
     
                 _saveState();
             }
-            
-            vTaskDelay(LEDS_DELAY / portTICK_PERIOD_MS);
+
+            // The serial buffer is too small to wait between frames while streaming
+            if (_mode == Mode::Adalight)
+                taskYIELD();
+            else
+                vTaskDelay(LEDS_DELAY / portTICK_PERIOD_MS);
         }
 
+        #if LEDS_SERIAL_STREAMING == 1
+            _detectStream();
+        #endif
+
         vTaskDelay(LEDS_DELAY / portTICK_PERIOD_MS);
     }
 }
@@ -116,7 +223,7 @@ void Display::White() {
     _reg8_a = 0;
 
     #if LOG >= 2
-        Serial.println(F("SolidColor"));
+        Log::Write(LogId::SolidColor);
     #endif
 }
 
@@ -128,7 +235,7 @@ void Display::SolidColor(CRGB color) {
     _reg8_a = 0;
 
     #if LOG >= 2
-        Serial.println(F("SolidColor"));
+        Log::Write(LogId::SolidColor);
     #endif
 }
 
@@ -139,7 +246,7 @@ void Display::Pulse(CRGB color) {
     _currentColor = color;
 
     #if LOG >= 2
-        Serial.println(F("Pulse"));
+        Log::Write(LogId::Pulse);
     #endif
 }
 
@@ -149,7 +256,7 @@ void Display::Rainbow() {
     _isTransiting = true;
 
     #if LOG >= 2
-        Serial.println(F("Rainbow"));
+        Log::Write(LogId::Rainbow);
     #endif
 }
 
@@ -157,9 +264,10 @@ void Display::Fire() {
     _remainingTime = (uint16_t)0 - 1; // Unlimited
     _mode = Mode::Fire;
     _isTransiting = true;
+    _updateWaveColors();
 
     #if LOG >= 2
-        Serial.println(F("Fire"));
+        Log::Write(LogId::Fire);
     #endif
 }
 
@@ -169,9 +277,10 @@ void Display::Aurora() {
     _isTransiting = true;
     _reg8_b = 160;
     _reg8_c = 110;
+    _updateWaveColors();
 
     #if LOG >= 2
-        Serial.println(F("Aurora"));
+        Log::Write(LogId::Aurora);
     #endif
 }
 
@@ -184,14 +293,63 @@ void Display::Disco() {
     _currentColor = CHSV(random8(), random8() / 16 + 239, 255);
 
     for (byte i = 0; i < 32; i++) {
-        for (byte i = 0; i < LEDS_NUMBER; i++) {
+        for (uint16_t i = 0; i < LEDS_NUMBER; i++) {
             strip[i] = blend(strip[i], 0x000000, 18);
         }
         vTaskDelay(16 / portTICK_PERIOD_MS);
     }
 
     #if LOG >= 2
-        Serial.println(F("Disco"));
+        Log::Write(LogId::Disco);
+    #endif
+}
+
+void Display::Program() {
+    _remainingTime = (uint16_t)0 - 1; // Unlimited
+    _mode = Mode::Program;
+    _isTransiting = true;
+
+    #if LOG >= 2
+        Log::Write(LogId::Program);
+    #endif
+}
+
+void Display::Clip() {
+    _remainingTime = (uint16_t)0 - 1; // Unlimited
+    _mode = Mode::Clip;
+    _isTransiting = true;
+    _reg8_b = 0;
+
+    #if LOG >= 2
+        Log::Write(LogId::Clip);
+    #endif
+}
+
+void Display::Audio() {
+    _remainingTime = (uint16_t)0 - 1; // Unlimited
+    _mode = Mode::Audio;
+    _isTransiting = true;
+    _reg8_b = 0;
+
+    #if LOG >= 2
+        Log::Write(LogId::Audio);
+    #endif
+}
+
+void Display::Adalight() {
+    // Make sure the EEPROM holds the state to restore at the end of the stream
+    if (_saveStateRequested) {
+        _saveStateRequested = false;
+        _saveState();
+    }
+
+    _remainingTime = (uint16_t)0 - 1; // Unlimited
+    _mode = Mode::Adalight;
+    _isTransiting = true;
+    _reg16_a = millis();
+
+    #if LOG >= 2
+        Log::Write(LogId::Adalight);
     #endif
 }
 
@@ -200,7 +358,7 @@ void Display::SwitchOff() {
     _printSolidColor(CRGB(0, 0, 0));
 
     #if LOG >= 2
-        Serial.println(F("SwitchOff"));
+        Log::Write(LogId::SwitchOff);
     #endif
 }
 
@@ -209,8 +367,7 @@ void Display::SetRemainingTime(uint16_t seconds) {
     _isTransiting = true;
     
     #if LOG >= 2
-        Serial.print(F("SetRemainingTime:"));
-        Serial.println(seconds);
+        Log::Write(LogId::SetRemainingTime, seconds);
     #endif
 }
 
@@ -220,20 +377,46 @@ void Display::SetColor(CRGB color) {
     _reg8_a = 0;
     _reg8_b = random8();
     _reg8_c = random8();
+    _updateWaveColors();
 
     #if LOG >= 2
-        Serial.print(F("SetColor "));
-        Serial.print(_currentColor.r);
-        Serial.print(" ");
-        Serial.print(_currentColor.g);
-        Serial.print(" ");
-        Serial.println(_currentColor.b);
+        Log::Write(LogId::SetColor, _currentColor.raw, 3);
     #endif
 }
 
 void Display::_printSolidColor(CRGB color) {
+    // The command is applied right now, not on the next frame
+    #if IO_TRACE == 1
+        Trace::Applied();
+    #endif
+
     fill_solid(strip, LEDS_NUMBER, color);
-    FastLED.show();
+    _show();
+}
+
+void Display::_show() {
+    #if LEDS_DOUBLE_BUFFER == 1
+        // The Output task clocks the frame out, and traces it
+        Output::Show(strip);
+    #else
+        #if IO_TRACE == 1
+            Trace::ShowStart();
+        #endif
+
+        FastLED.show();
+
+        #if IO_TRACE == 1
+            Trace::ShowEnd();
+        #endif
+    #endif
+
+    #if LOG >= 2
+        if (!firstFrameShown) {
+            firstFrameShown = true;
+            unsigned long now = millis();
+            Log::Write(LogId::FirstFrame, &now, sizeof(now));
+        }
+    #endif
 }
 
 void Display::_fadeToColor(CRGB color) {
@@ -257,40 +440,189 @@ void Display::_animateToColor(CRGB color) {
     _reg8_a++;
 }
 
-void Display::_drawFire() {
-    CHSV color1, color2;
+void Display::_drawFire(unsigned long time) {
+    CRGB color1, color2;
     
-    for (byte i=0 ; i<LEDS_NUMBER ; i++) {
+    for (uint16_t i=0 ; i<LEDS_NUMBER ; i++) {
         // First wave, going forwards
-        color1 = CHSV(10, 255, 96 * cos(0.003 * millis() + 0.2 * i - sin(i)) + 159);
+        color1 = waveColor1;
+        color1.nscale8_video(dim8_video(96 * cos(0.003 * time + 0.2 * i - sin(i)) + 159));
 
         // Second wave, goind backwards
-        color2 = CHSV(25, 255, 127 * cos(-0.0085 * millis() + 3.2 * i + sin(i)) + 127);
+        color2 = waveColor2;
+        color2.nscale8_video(dim8_video(127 * cos(-0.0085 * time + 3.2 * i + sin(i)) + 127));
         
-        strip[i] = CRGB(color1) + CRGB(color2);
+        strip[i] = color1 + color2;
     }
+}
 
-    FastLED.show();
+void Display::_updateWaveColors() {
+    // hsv2rgb_rainbow squares the value before scaling the channels: a fully saturated color dimmed
+    // with nscale8_video(dim8_video(v)) is within one level of CHSV(hue, 255, v) (see tools/host/hue_check.cpp)
+    if (_mode == Mode::Fire) {
+        waveColor1 = CHSV(10, 255, 255);
+        waveColor2 = CHSV(25, 255, 255);
+    }
+    else if (_mode == Mode::Aurora) {
+        waveColor1 = CHSV(_reg8_b, 255, 255);
+        waveColor2 = CHSV(_reg8_c, 255, 255);
+    }
 }
 
-void Display::_drawAurora() {
-    CHSV color1, color2;
-    
-    for (byte i=0 ; i<LEDS_NUMBER ; i++) {
+void Display::_drawRainbow() {
+    // In this mode _reg8_a is the hue of the first pixel and _reg8_b the frames since the last step
+    if (_isTransiting) {
+        _isTransiting = false;
+        _reg8_b = 0;
+        fill_rainbow(strip, LEDS_NUMBER, _reg8_a, RAINBOW_DELTA);
+        return;
+    }
+
+    // The rainbow moves by one pixel every RAINBOW_DELTA frames: the first pixel takes the hue of the
+    // second one, so the strip is still the fill_rainbow of _reg8_a, and only the pixel entering is computed
+    if (++_reg8_b < RAINBOW_DELTA)
+        return;
+
+    _reg8_b = 0;
+    _reg8_a += RAINBOW_DELTA;
+    memmove(strip, strip + 1, (LEDS_NUMBER - 1) * sizeof(CRGB));
+    strip[LEDS_NUMBER - 1] = CHSV(_reg8_a + (LEDS_NUMBER - 1) * RAINBOW_DELTA, 240, 255);
+}
+
+#if LEDS_MATRIX == 0
+
+void Display::_drawAurora(unsigned long time) {
+    // In this mode _reg16_a is the number of steps the first wave has moved
+    CRGB color1, color2;
+    unsigned long step = time / AURORA_STEP_PERIOD;
+
+    // The first wave is a pure translation: only the pixels entering the strip are computed
+    uint16_t missing = LEDS_NUMBER;
+    if (!_isTransiting && step - _reg16_a < LEDS_NUMBER)
+        missing = step - _reg16_a;
+
+    for (; missing > 0; missing--) {
+        unsigned long position = step + LEDS_NUMBER - missing;
+        auroraWave[position % LEDS_NUMBER] = 127.0 * cos(0.1 * position) + 127;
+    }
+
+    _reg16_a = step;
+    _isTransiting = false;
+
+    uint16_t ring = step % LEDS_NUMBER;
+
+    for (uint16_t i=0 ; i<LEDS_NUMBER ; i++) {
         // First wave, going forwards
-        //color1 = CHSV(160, 255, 127.0 * cos(0.0005 * millis() + 0.1 * i) + 127);
-        color1 = CHSV(_reg8_b, 255, 127.0 * cos(0.0005 * millis() + 0.1 * i) + 127);
+        color1 = waveColor1;
+        color1.nscale8_video(dim8_video(auroraWave[ring]));
+        if (++ring == LEDS_NUMBER)
+            ring = 0;
 
         // Second wave, goind backwards
         //color2 = CHSV(110, 255, 127.0 * cos(-0.001 * millis() + 0.8 * i + sin(i)) + 127);
-        color2 = CHSV(_reg8_c, 255, 127.0 * cos(-0.001 * millis() + 0.8 * i + sin(i)) + 127);
+        color2 = waveColor2;
+        color2.nscale8_video(dim8_video(127.0 * cos(-0.001 * time + 0.8 * i + sin(i)) + 127));
         
-        strip[i] = CRGB(color1) + CRGB(color2);
+        strip[i] = color1 + color2;
+    }
+}
+
+#endif
+
+#if LEDS_MATRIX == 1
+
+void Display::_drawFire2D(unsigned long time) {
+    CRGB color1, color2;
+    uint16_t pixel = 0;
+
+    // The pixels are visited in the order of the table, so their index in the strip is just read
+    for (byte y = 0; y < MATRIX_HEIGHT; y++) {
+        // The flames fade out towards the top
+        byte height = 255 - y * 255 / MATRIX_HEIGHT;
+
+        for (byte x = 0; x < MATRIX_WIDTH; x++) {
+            // First wave, going upwards
+            color1 = waveColor1;
+            color1.nscale8_video(dim8_video(scale8(96 * cos(0.003 * time - 0.4 * y + sin(x)) + 159, height)));
+
+            // Second wave, flickering sideways
+            color2 = waveColor2;
+            color2.nscale8_video(dim8_video(scale8(127 * cos(-0.0085 * time + 3.2 * x + sin(y)) + 127, height)));
+
+            strip[Matrix::Index(pixel++)] = color1 + color2;
+        }
     }
+}
+
+void Display::_drawAurora2D(unsigned long time) {
+    CRGB color1, color2;
+    uint16_t pixel = 0;
+
+    for (byte y = 0; y < MATRIX_HEIGHT; y++) {
+        // The curtains hang from the top
+        byte height = y * 255 / (MATRIX_HEIGHT - 1);
+
+        for (byte x = 0; x < MATRIX_WIDTH; x++) {
+            // First wave, waving sideways
+            color1 = waveColor1;
+            color1.nscale8_video(dim8_video(127.0 * cos(0.0005 * time + 0.1 * x + 0.05 * y) + 127));
+
+            // Second wave, going backwards and falling
+            color2 = waveColor2;
+            color2.nscale8_video(dim8_video(scale8(127.0 * cos(-0.001 * time + 0.8 * x + sin(y)) + 127, height)));
 
-    FastLED.show();
+            strip[Matrix::Index(pixel++)] = color1 + color2;
+        }
+    }
 }
 
+#endif
+
+void Display::_drawKeyframe(unsigned long time) {
+    if (_mode == Mode::Fire) {
+        #if LEDS_MATRIX == 1
+            _drawFire2D(time);
+        #else
+            _drawFire(time);
+        #endif
+    }
+    else {
+        #if LEDS_MATRIX == 1
+            _drawAurora2D(time);
+        #else
+            _drawAurora(time);
+        #endif
+    }
+}
+
+#if LEDS_KEYFRAMES > 1
+
+void Display::_drawKeyframes() {
+    unsigned long now = millis();
+
+    // Start over when the mode or its colors changed, or when the frames stopped for a while.
+    // The next keyframe is rendered for now, so that it becomes the previous one right below.
+    if (_isTransiting || now - keyframeStart >= 2 * KEYFRAME_PERIOD) {
+        _drawKeyframe(now);
+        memcpy(keyframeTo, strip, sizeof(strip));
+        keyframeStart = now - KEYFRAME_PERIOD;
+        _isTransiting = false;
+    }
+
+    // The frame is rendered in advance, at the time it will be shown entirely
+    if (now - keyframeStart >= KEYFRAME_PERIOD) {
+        keyframeStart += KEYFRAME_PERIOD;
+        memcpy(keyframeFrom, keyframeTo, sizeof(strip));
+        _drawKeyframe(keyframeStart + KEYFRAME_PERIOD);
+        memcpy(keyframeTo, strip, sizeof(strip));
+    }
+
+    fract8 progress = (now - keyframeStart) * 256 / KEYFRAME_PERIOD;
+    for (uint16_t i = 0; i < LEDS_NUMBER; i++)
+        strip[i] = blend(keyframeFrom[i], keyframeTo[i], progress);
+}
+
+#endif
 
 void Display::_drawDisco() {
     // In this mode _reg16_a is the last millis() and _reg8_a is the selected section
@@ -306,7 +638,7 @@ void Display::_drawDisco() {
                 _isTransiting = false;
         }
         else {
-            for (byte i = _reg8_a * 10; i < _reg8_a * 10 + 10 && i < LEDS_NUMBER; i++) {
+            for (uint16_t i = _reg8_a * 10; i < _reg8_a * 10 + 10 && i < LEDS_NUMBER; i++) {
                 strip[i] = blend(strip[i], _currentColor, 38);
             }
         }
@@ -326,11 +658,118 @@ void Display::_drawDisco() {
     }
 
     // Fade the selected section to the current color
-    for (byte i = _reg8_a * 10; i < _reg8_a * 10 + 10 && i < LEDS_NUMBER; i++) {
+    for (uint16_t i = _reg8_a * 10; i < _reg8_a * 10 + 10 && i < LEDS_NUMBER; i++) {
         strip[i] = blend(strip[i], _currentColor, 24);
     }
 }
 
+#if LEDS_CLIP == 1
+
+void Display::_drawClip() {
+    // In this mode _reg8_b is the number of the clip and _reg16_a the time of the last frame
+
+    // The SD card shares the SPI bus with the Ethernet controller. If it is busy, try again on the next tick.
+    if (!SpiLock::Take(1))
+        return;
+
+    // Open the selected clip, or the next one available
+    if (_isTransiting) {
+        _isTransiting = false;
+
+        for (byte i = 0; i < CLIP_MAX_NUMBER; i++) {
+            if (ClipReader::Open(_reg8_b + i)) {
+                _reg8_b = (_reg8_b + i) % CLIP_MAX_NUMBER;
+                _reg16_a = millis() - ClipReader::GetPeriod();
+                break;
+            }
+        }
+
+        #if LOG >= 1
+            if (!ClipReader::IsOpen())
+                Log::Write(LogId::NoClip);
+        #endif
+    }
+
+    // Decode the frames due since the last tick, a few at most
+    for (byte i = 0; i < 4 && ClipReader::IsOpen() && millis() - _reg16_a >= ClipReader::GetPeriod(); i++) {
+        ClipReader::ReadFrame(strip, LEDS_NUMBER);
+        _reg16_a += ClipReader::GetPeriod();
+    }
+
+    // Too late, don't try to catch up
+    if (millis() - _reg16_a >= ClipReader::GetPeriod())
+        _reg16_a = millis();
+
+    SpiLock::Give();
+}
+
+#endif
+
+#if LEDS_PROGRAM == 1
+
+void Display::_drawProgram() {
+    // In this mode _reg8_b is the hue given to the program
+    Vm::Render(strip, LEDS_NUMBER, _reg8_b);
+}
+
+#endif
+
+#if LEDS_AUDIO == 1
+
+void Display::_drawAudio() {
+    // In this mode _reg8_b is the hue of the lowest band
+
+    Spectrum::Analyze(LEDS_AUDIO_PIN);
+
+    // Each band gets its own section and hue, its level gives the brightness
+    for (uint16_t i = 0; i < LEDS_NUMBER; i++) {
+        byte band = (uint16_t)i * SPECTRUM_BANDS / LEDS_NUMBER;
+        strip[i] = CHSV(_reg8_b + band * (256 / SPECTRUM_BANDS), 255, Spectrum::GetLevel(band));
+    }
+}
+
+#endif
+
+#if LEDS_SERIAL_STREAMING == 1
+
+void Display::_detectStream() {
+    // Only the bytes received since the last tick are available, the header will be caught on one of the next frames
+    while (Serial.available()) {
+        SerialStream::Decode(Serial.read(), strip, LEDS_NUMBER);
+
+        if (SerialStream::InFrame()) {
+            Adalight();
+            return;
+        }
+    }
+}
+
+void Display::_drawStream() {
+    // In this mode _reg16_a is the time of the last frame received
+
+    // Read continuously until the end of the frame, for at most one tick
+    unsigned long start = millis();
+    while (millis() - start < LEDS_DELAY) {
+        if (Serial.available() && SerialStream::Decode(Serial.read(), strip, LEDS_NUMBER)) {
+            _reg16_a = millis();
+            _show();
+            return;
+        }
+    }
+
+    // The computer stopped streaming, go back to the saved mode
+    if (millis() - _reg16_a >= LEDS_SERIAL_TIMEOUT) {
+        SerialStream::Reset();
+        LoadState();
+
+        #if LOG >= 2
+            Log::Write(LogId::AdalightTimeout);
+        #endif
+    }
+}
+
+#endif
+
 void Display::RequestSaveState() {
     _saveStateRequested = true;
     _prevMillisSaveState = millis();
@@ -340,9 +779,11 @@ void Display::_saveState() {
     int eepromCursor = 0;
 
     #if LOG >= 2
-        Serial.println(F("Saving state to EEPROM"));
+        Log::Write(LogId::SavingState);
     #endif
 
+    _saveCount++;
+
     uint16_t eepromMagicNumber = EEPROM_MAGIC_NUMBER;
     
     EEPROM.put(eepromCursor, eepromMagicNumber);
@@ -364,11 +805,15 @@ void Display::_saveState() {
     eepromCursor += sizeof(_reg8_c);
 }
 
+uint16_t Display::GetSaveCount() {
+    return _saveCount;
+}
+
 void Display::LoadState() {
     int eepromCursor = 0;
 
     #if LOG >= 2
-        Serial.println(F("Loading state from EEPROM"));
+        Log::Write(LogId::LoadingState);
     #endif
 
     uint16_t eepromMagicNumber = 0;
@@ -380,7 +825,7 @@ void Display::LoadState() {
     // If it does not correspond, it means this EEPROM does not contain state data
     if (eepromMagicNumber != EEPROM_MAGIC_NUMBER) {
         #if LOG >= 2
-            Serial.println(F("No data on EEPROM"));
+            Log::Write(LogId::NoState);
         #endif
 
         // Default to white display
@@ -403,6 +848,8 @@ void Display::LoadState() {
 
     EEPROM.get(eepromCursor, _reg8_c);
     eepromCursor += sizeof(_reg8_c);
+
+    _updateWaveColors();
 }
 
 uint16_t Display::_remainingTime = 0;
@@ -424,3 +871,5 @@ bool Display::_isTransiting = true;
 bool Display::_saveStateRequested = false;
 
 unsigned long Display::_prevMillisSaveState = 0;
+
+uint16_t Display::_saveCount = 0;
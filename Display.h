@@ -39,7 +39,11 @@ enum class Mode : byte {
     Rainbow = 4,
     Fire = 5,
     Aurora = 6,
-    Disco = 7
+    Disco = 7,
+    Adalight = 8,
+    Audio = 9,
+    Program = 10,
+    Clip = 11
 };
 
 
@@ -91,6 +95,31 @@ public:
      */
     static void Disco();
 
+    /**
+     * Adalight mode
+     * The colors are streamed by a computer through the serial port.
+     * Entered automatically when a frame is received, left after LEDS_SERIAL_TIMEOUT without any frame.
+     */
+    static void Adalight();
+
+    /**
+     * Audio mode
+     * Each section of the strip lights up with a frequency band of the sound
+     */
+    static void Audio();
+
+    /**
+     * Program mode
+     * Runs the effect uploaded through MQTT
+     */
+    static void Program();
+
+    /**
+     * Clip mode
+     * Plays an animation from the SD card. var switches to another clip.
+     */
+    static void Clip();
+
     /**
      * Set the timer
      */
@@ -118,6 +147,11 @@ public:
      */
     static void LoadState();
 
+    /**
+     * @return The number of times the state have been saved to the EEPROM since startup
+     */
+    static uint16_t GetSaveCount();
+
 private:
     /**
      * DisplayMode
@@ -171,11 +205,21 @@ private:
      */
     static unsigned long _prevMillisSaveState;
 
+    /**
+     * Number of times the state have been saved to the EEPROM since startup
+     */
+    static uint16_t _saveCount;
+
     /**
      * Print the same color on every led of the ring
      */
     static void _printSolidColor(CRGB color);
 
+    /**
+     * Send the strip to the leds
+     */
+    static void _show();
+
     /**
      * Fade the given color into the strip pixels
      */
@@ -186,21 +230,80 @@ private:
      */
     static void _animateToColor(CRGB color);
 
+    /**
+     * The core logic for the Rainbow mode
+     */
+    static void _drawRainbow();
+
     /**
      * The core logic for the Fire mode
+     * @param time Time of the frame, as given by millis()
+     */
+    static void _drawFire(unsigned long time);
+
+    /**
+     * Convert the hues of the two waves of Fire or Aurora, for the current mode
      */
-    static void _drawFire();
+    static void _updateWaveColors();
 
     /**
      * The core logic for the Aurora mode
+     * @param time Time of the frame, as given by millis()
      */
-    static void _drawAurora();
+    static void _drawAurora(unsigned long time);
+
+    /**
+     * The core logic for the Fire mode, on a matrix
+     * @param time Time of the frame, as given by millis()
+     */
+    static void _drawFire2D(unsigned long time);
+
+    /**
+     * The core logic for the Aurora mode, on a matrix
+     * @param time Time of the frame, as given by millis()
+     */
+    static void _drawAurora2D(unsigned long time);
+
+    /**
+     * Draw Fire or Aurora by blending the frames rendered at two keyframes
+     */
+    static void _drawKeyframes();
+
+    /**
+     * Render the frame of Fire or Aurora at the given time
+     */
+    static void _drawKeyframe(unsigned long time);
 
     /**
      * The core logic for the Disco mode
      */
     static void _drawDisco();
 
+    /**
+     * The core logic for the Clip mode
+     */
+    static void _drawClip();
+
+    /**
+     * The core logic for the Program mode
+     */
+    static void _drawProgram();
+
+    /**
+     * The core logic for the Audio mode
+     */
+    static void _drawAudio();
+
+    /**
+     * Look for an Adalight header on the serial port and switch to the Adalight mode if any
+     */
+    static void _detectStream();
+
+    /**
+     * The core logic for the Adalight mode
+     */
+    static void _drawStream();
+
     /**
      * Save the current state to the EEPROM
      */
@@ -29,20 +29,83 @@
 
 #include "Display.h"
 #include "Io.h"
+#include "Log.h"
 #include "config.h"
 
+#if LEDS_PROGRAM == 1
+    #include "Vm.h"
+#endif
+
+#if LEDS_CLIP == 1
+    #include "SpiLock.h"
+#endif
+
+#if IO_TRACE == 1
+    #include "Trace.h"
+#endif
+
 #if IO_NETWORKING == 1
     #include <EthernetClient.h>
-    #include <PubSubClient.h>
+    #include "Mqtt.h"
+    #include "Text.h"
+
+    #if IO_LEASE_CACHE == 1 || IO_GROUPS == 1
+        #include <EEPROM.h>
+    #endif
 
     EthernetClient eth;
-    PubSubClient mqtt(eth);
-    const char t_lights_all[] = "lights/all";
-    const char t_lights_all_color[] = "lights/all/color";
+    Mqtt mqtt(eth);
+    // The constant strings stay in the program memory, see Mqtt::subscribe_P and strcmp_P
+    const char t_lights_all[] PROGMEM = "lights/all";
+    const char t_lights_all_color[] PROGMEM = "lights/all/color";
+    #if LEDS_PROGRAM == 1
+        const char t_lights_all_program[] PROGMEM = "lights/all/program";
+    #endif
+    #if IO_TRACE == 1
+        const char t_lights_trace[] PROGMEM = "lights/trace";
+    #endif
+    #if IO_GROUPS == 1
+        // Followed by the MAC address of the device ("lights/xxxxxxxxxxxx") or the number of the group ("lights/group/x")
+        const char t_lights_device[] PROGMEM = "lights/";
+        const char t_lights_group[] PROGMEM = "lights/group/";
+        byte groups = 0; // Groups the device is member of, one bit per group
+    #endif
+    #if IO_STATS == 1
+        const char t_lights_stats[] PROGMEM = "lights/stats";
+        unsigned long statMessages = 0; // Number of messages received
+        unsigned long statInvalid = 0; // Number of messages not understood
+    #endif
     bool ethConnected = false;
     unsigned long prevMillisNetwork; // Timer used for the network monitoring
+
+    #if IO_LEASE_CACHE == 1
+        // Arbitrary byte used to determine if a lease have been saved on the EEPROM
+        #define IO_LEASE_MAGIC_NUMBER 0xB7
+
+        /**
+         * Network configuration of the last successful connection, as stored in the EEPROM
+         */
+        struct Lease {
+            byte magic;
+            byte ip[4];
+            byte gateway[4];
+            byte dns[4];
+            byte subnet[4];
+            byte broker[4];
+        };
+
+        bool leaseUsed = false; // true when the interface have been configured from the cached lease
+    #endif
+
+    #if IO_GROUPS == 1
+        // Arbitrary byte used to determine if the group membership have been saved on the EEPROM
+        #define IO_GROUPS_MAGIC_NUMBER 0x5C
+    #endif
 #endif
 
+// Number of modes selectable with the mode button and command. The optional ones come last.
+#define IO_MODES_NUMBER (8 + LEDS_AUDIO + LEDS_CLIP)
+
 byte currentMode = 1;
 
 void Io::Task(void *pvParameters) {
@@ -55,20 +118,43 @@ void Io::Task(void *pvParameters) {
 
     #if IO_NETWORKING == 1
         prevMillisNetwork = millis();
+
+        #if IO_GROUPS == 1
+            _loadGroups();
+        #endif
+
+        #if LEDS_CLIP == 1
+            // The SD card shares the SPI bus with the Ethernet controller
+            SpiLock::Take();
+        #endif
         
         // disable SD card
         pinMode(4, OUTPUT);
         digitalWrite(4, HIGH);
 
         _connect();
+
+        #if LEDS_CLIP == 1
+            SpiLock::Give();
+        #endif
     #endif
 
     for (;;) {
+        #if LEDS_CLIP == 1 && IO_NETWORKING == 1
+            SpiLock::Take();
+        #endif
+
         buttonState = digitalRead(IO_BUTTON_MODE_PIN);
         
         if (buttonState != lastButtonModeState) {
             if (buttonState == HIGH) {
+                #if IO_TRACE == 1
+                    Trace::Begin(0);
+                #endif
                 _nextMode();
+                #if IO_TRACE == 1
+                    Trace::Applied();
+                #endif
             }
         }
 
@@ -78,7 +164,13 @@ void Io::Task(void *pvParameters) {
         
         if (buttonState != lastButtonVarState) {
             if (buttonState == HIGH) {
+                #if IO_TRACE == 1
+                    Trace::Begin(0);
+                #endif
                 _var();
+                #if IO_TRACE == 1
+                    Trace::Applied();
+                #endif
             }
         }
 
@@ -89,12 +181,23 @@ void Io::Task(void *pvParameters) {
                 mqtt.loop();
             }
 
+            #if IO_TRACE == 1
+                char report[TRACE_REPORT_SIZE];
+                if (Trace::Report(report) && mqtt.connected()) {
+                    mqtt.publish_P(t_lights_trace, report);
+                }
+            #endif
+
             // Periodically check network status
             if (millis() - prevMillisNetwork >= 30000) {
                 prevMillisNetwork = millis();
                 _connect();
             }
         #endif
+
+        #if LEDS_CLIP == 1 && IO_NETWORKING == 1
+            SpiLock::Give();
+        #endif
         
         vTaskDelay(IO_SCAN_DELAY / portTICK_PERIOD_MS);
     }
@@ -103,109 +206,430 @@ void Io::Task(void *pvParameters) {
 #if IO_NETWORKING == 1
 
 void Io::_connect() {
-    // Start the ethernet interface and try to get an IP address from the DHCP server.
-    if (!ethConnected) {
-        #if LOG >= 1
-            Serial.println(F("Connecting eth..."));
+    if (!ethConnected)
+        _startEthernet();
+
+    if (ethConnected) {
+        #if IO_LEASE_CACHE == 1
+            // The cached lease only spares the wait at boot: the DHCP server doesn't know it is still in use,
+            // and would give the address to another host once it expires. Ask for it once the lights are up.
+            if (leaseUsed) {
+                if (mqtt.connected())
+                    _renewLease();
+            }
+            else {
+                Ethernet.maintain();
+            }
+        #else
+            // Renew the lease when it is due
+            Ethernet.maintain();
         #endif
-        byte mac[] = IO_MAC_ADDRESS;
-        if (Ethernet.begin(mac, 5000) == 0) {
-            digitalWrite(13, LOW);
-            ethConnected = false;
-            #if LOG >= 2
-                Serial.print(F("eth failed "));
-                Serial.println(Ethernet.localIP());
-            #endif
-        }
-        else {
+    }
+
+    // Connect to the MQTT broker
+    if (ethConnected && !mqtt.connected()) {
+        #if IO_LEASE_CACHE == 1
+            bool connected = _connectBroker();
+
+            // The cached lease may be stale (e.g. the address have been given to another device):
+            // get a new one from the DHCP server right away
+            if (!connected && leaseUsed) {
+                #if LOG >= 1
+                    Log::Write(LogId::LeaseStale);
+                #endif
+                _clearLease();
+                ethConnected = false;
+                _startEthernet();
+                if (ethConnected)
+                    connected = _connectBroker();
+            }
+
+            if (connected && !leaseUsed)
+                _saveLease();
+        #else
+            _connectBroker();
+        #endif
+    }
+}
+
+void Io::_startEthernet() {
+    #if LOG >= 1
+        Log::Write(LogId::Connecting);
+    #endif
+    byte mac[] = IO_MAC_ADDRESS;
+
+    #if IO_LEASE_CACHE == 1
+        // Fast path: reuse the last lease without waiting for the DHCP server
+        Lease lease;
+        EEPROM.get(IO_LEASE_EEPROM_ADDRESS, lease);
+        if (lease.magic == IO_LEASE_MAGIC_NUMBER) {
+            Ethernet.begin(mac, IPAddress(lease.ip), IPAddress(lease.dns), IPAddress(lease.gateway), IPAddress(lease.subnet));
+            mqtt.setServer(IPAddress(lease.broker), 1883);
             ethConnected = true;
+            leaseUsed = true;
             #if LOG >= 2
-                Serial.print(F("DHCP assigned IP "));
-                Serial.println(Ethernet.localIP());
+                _logIp(LogId::LeaseCached);
             #endif
+            return;
         }
-    }
+        leaseUsed = false;
+    #endif
 
-    // Connect to the MQTT broker
-    if (ethConnected && !mqtt.connected()) {
+    // Try to get an IP address from the DHCP server
+    if (Ethernet.begin(mac, 5000) == 0) {
+        digitalWrite(13, LOW);
+        ethConnected = false;
         #if LOG >= 2
-            Serial.println(F("Trying to connect to the broker..."));
+            _logIp(LogId::EthFailed);
         #endif
+    }
+    else {
+        ethConnected = true;
         mqtt.setServer(IO_BROKER_ADDRESS, 1883);
-        mqtt.setCallback(Io::_callback);
-        char clientId[23]; // "light_xx:xx:xx:xx:xx:xx"
-        byte mac[] = IO_MAC_ADDRESS;
-        sprintf(clientId, "light_%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-        if (mqtt.connect(clientId))
-        {
-            digitalWrite(13, HIGH);
-            mqtt.subscribe(t_lights_all);
-            mqtt.subscribe(t_lights_all_color);
-            #if LOG >= 1
-                Serial.println(F("Connected to broker"));
-            #endif
-        }
-        else
-        {
-            digitalWrite(13, LOW);
-            #if LOG >= 1
-                Serial.println(F("Failed to connect to broker"));
-            #endif
-        }
+        #if LOG >= 2
+            _logIp(LogId::DhcpAssigned);
+        #endif
+    }
+}
+
+bool Io::_connectBroker() {
+    #if LOG >= 2
+        Log::Write(LogId::ConnectingBroker);
+    #endif
+    mqtt.setCallback(Io::_callback);
+    char clientId[24];
+    _clientId(clientId);
+    if (mqtt.connect(clientId))
+    {
+        digitalWrite(13, HIGH);
+        mqtt.subscribe_P(t_lights_all);
+        mqtt.subscribe_P(t_lights_all_color);
+        #if LEDS_PROGRAM == 1
+            mqtt.subscribe_P(t_lights_all_program);
+        #endif
+        #if IO_GROUPS == 1
+            _subscribeDevice();
+            _subscribeGroups(true);
+        #endif
+        #if LOG >= 1
+            Log::Write(LogId::Connected);
+        #endif
+        #if LOG >= 2
+            unsigned long now = millis();
+            Log::Write(LogId::BrokerReady, &now, sizeof(now));
+        #endif
+        return true;
+    }
+
+    digitalWrite(13, LOW);
+    #if LOG >= 1
+        Log::Write(LogId::ConnectionFailed);
+    #endif
+    return false;
+}
+
+#if IO_LEASE_CACHE == 1
+
+void Io::_saveLease() {
+    Lease lease;
+    IPAddress address;
+
+    lease.magic = IO_LEASE_MAGIC_NUMBER;
+    address = Ethernet.localIP();
+    for (byte i = 0; i < 4; i++) lease.ip[i] = address[i];
+    address = Ethernet.gatewayIP();
+    for (byte i = 0; i < 4; i++) lease.gateway[i] = address[i];
+    address = Ethernet.dnsServerIP();
+    for (byte i = 0; i < 4; i++) lease.dns[i] = address[i];
+    address = Ethernet.subnetMask();
+    for (byte i = 0; i < 4; i++) lease.subnet[i] = address[i];
+    // The broker's address as resolved on connection
+    address = eth.remoteIP();
+    for (byte i = 0; i < 4; i++) lease.broker[i] = address[i];
+
+    // Spare the EEPROM: most of the time, the DHCP server gives the same lease again
+    Lease saved;
+    EEPROM.get(IO_LEASE_EEPROM_ADDRESS, saved);
+    if (memcmp(&lease, &saved, sizeof(Lease)) != 0)
+        EEPROM.put(IO_LEASE_EEPROM_ADDRESS, lease);
+}
+
+void Io::_renewLease() {
+    #if LOG >= 2
+        Log::Write(LogId::LeaseRenewal);
+    #endif
+    byte mac[] = IO_MAC_ADDRESS;
+
+    // Ethernet.begin resets the controller, which closes the connection with the broker
+    mqtt.disconnect();
+    if (Ethernet.begin(mac, 5000) == 0) {
+        // The DHCP server doesn't answer: keep going with the cached lease, and ask again on the next check
+        _startEthernet();
+        return;
     }
+
+    leaseUsed = false;
+    mqtt.setServer(IO_BROKER_ADDRESS, 1883);
+    #if LOG >= 2
+        _logIp(LogId::DhcpAssigned);
+    #endif
+}
+
+void Io::_clearLease() {
+    EEPROM.update(IO_LEASE_EEPROM_ADDRESS, 0);
+    leaseUsed = false;
 }
 
+#endif
+
 void Io::_callback(char* topic, byte* payload, unsigned int length) {
-    char buffer[17] = { 0 };
-    strncpy(buffer, (char*)payload, min(16, length));
+    #if IO_STATS == 1
+        statMessages++;
+    #endif
+
+    #if LEDS_PROGRAM == 1
+        // Programs are binary, they are not handled as the other commands
+        if (strcmp_P(topic, t_lights_all_program) == 0) {
+            if (Vm::Load(payload, length)) {
+                Vm::Save();
+                Display::Program();
+                Display::RequestSaveState();
+            }
+            else {
+                #if IO_STATS == 1
+                    statInvalid++;
+                #endif
+                #if LOG >= 1
+                    Log::Write(LogId::InvalidProgram);
+                #endif
+            }
+            return;
+        }
+    #endif
+
+    // The payload is already truncated and null terminated by the MQTT client
+    char* buffer = (char*)payload;
+    bool save = true; // false for the commands that don't change the display state
+
+    #if IO_TRACE == 1 || IO_GROUPS == 1
+        // Options can follow the command, after a space (e.g. "mode 42 @05")
+        char* separator = strchr(buffer, ' ');
+        if (separator != NULL) {
+            *separator = '\0';
+            if (!_parseOptions(separator + 1))
+                return;
+        }
+    #endif
     
     #if LOG >= 3
-        Serial.print(F("In msg ["));
-        Serial.print(topic);
-        Serial.print("] ");
-        Serial.print(buffer);
-        Serial.println();
+        Log::Write(LogId::InTopic, topic, strlen(topic));
+        Log::Write(LogId::InPayload, buffer, strlen(buffer));
     #endif
 
-    if (strcmp(buffer, "on") == 0) {
+    if (strcmp_P(buffer, PSTR("on")) == 0) {
         Display::SetRemainingTime((uint16_t)0 - 1); // Unlimited
     }
-    else if (strcmp(buffer, "off") == 0) {
+    else if (strcmp_P(buffer, PSTR("off")) == 0) {
         Display::SwitchOff();
     }
-    else if (strcmp(buffer, "mode") == 0) {
+    else if (strcmp_P(buffer, PSTR("mode")) == 0) {
         _nextMode();
     }
-    else if (strcmp(buffer, "var") == 0) {
+    else if (strcmp_P(buffer, PSTR("var")) == 0) {
         _var();
     }
-    else if (buffer[0] == '#' && length == 7) {
+    #if LEDS_PROGRAM == 1
+        else if (strcmp_P(buffer, PSTR("program")) == 0) {
+            // Without any program, the mode would freeze the leds on the previous frame
+            if (Vm::IsLoaded())
+                Display::Program();
+            #if IO_STATS == 1
+                else
+                    statInvalid++;
+            #endif
+        }
+    #endif
+    #if IO_GROUPS == 1
+        else if (strncmp_P(buffer, PSTR("groups="), 7) == 0) {
+            byte mask = 0;
+            if (strlen(buffer) == 9 && Text::ParseHex(buffer + 7, &mask))
+                _setGroups(mask);
+            #if IO_STATS == 1
+                else
+                    statInvalid++;
+            #endif
+            save = false;
+        }
+    #endif
+    #if IO_STATS == 1
+        else if (strcmp_P(buffer, PSTR("stats")) == 0) {
+            _publishStats();
+            save = false;
+        }
+    #endif
+    else if (buffer[0] == '#' && strlen(buffer) == 7) {
         byte r=0, g=0, b=0;
         if (_parseColor(buffer, &r, &g, &b))
         {
             CRGB newColor(r, g, b);
             Display::SetColor(newColor);
         }
+        #if IO_STATS == 1
+            else {
+                statInvalid++;
+            }
+        #endif
     }
+    #if IO_STATS == 1
+        else {
+            statInvalid++;
+        }
+    #endif
 
-    Display::RequestSaveState();
+    #if IO_TRACE == 1
+        Trace::Applied();
+    #endif
+
+    if (save)
+        Display::RequestSaveState();
 }
 
-bool Io::_parseColor(char hex[], byte* r, byte* g, byte* b) {
-    byte tr=0, tg=255, tb=0;
+#if IO_TRACE == 1 || IO_GROUPS == 1
 
-    // For efficiency, we trust here the string is 7 char long. Should be checked above.
-    for (byte i=1; i < 7; i++) {
-        if (!isxdigit(hex[i]))
-            return false;
+bool Io::_parseOptions(char options[]) {
+    #if IO_TRACE == 1
+        bool traced = false;
+        uint16_t traceId = 0;
+    #endif
+
+    char* option = options;
+    while (*option != '\0') {
+        #if IO_GROUPS == 1
+            // Groups the command is meant for, as a bitmask of two hexadecimal digits (e.g. "@05" for the groups 0 and 2).
+            // A mask that can't be read matches no group, so a typo doesn't reach every device.
+            if (option[0] == '@') {
+                byte mask = 0;
+                if (!Text::ParseHex(option + 1, &mask) || (option[3] != ' ' && option[3] != '\0') || (mask & groups) == 0)
+                    return false;
+            }
+        #endif
+
+        #if IO_TRACE == 1
+            // Trace identifier (e.g. "42")
+            if (*option >= '0' && *option <= '9') {
+                traced = true;
+                for (; *option >= '0' && *option <= '9'; option++)
+                    traceId = traceId * 10 + (*option - '0');
+            }
+        #endif
+
+        // Skip to the next option
+        while (*option != ' ' && *option != '\0')
+            option++;
+        while (*option == ' ')
+            option++;
+    }
+
+    #if IO_TRACE == 1
+        if (traced)
+            Trace::Begin(traceId);
+    #endif
+
+    return true;
+}
+
+#endif
+
+#if IO_GROUPS == 1
+
+void Io::_loadGroups() {
+    // Devices never configured are in no group
+    if (EEPROM.read(IO_GROUPS_EEPROM_ADDRESS) == IO_GROUPS_MAGIC_NUMBER)
+        groups = EEPROM.read(IO_GROUPS_EEPROM_ADDRESS + 1);
+}
+
+void Io::_setGroups(byte mask) {
+    if (mqtt.connected())
+        _subscribeGroups(false);
+
+    groups = mask;
+    EEPROM.update(IO_GROUPS_EEPROM_ADDRESS, IO_GROUPS_MAGIC_NUMBER);
+    EEPROM.update(IO_GROUPS_EEPROM_ADDRESS + 1, groups);
+
+    if (mqtt.connected())
+        _subscribeGroups(true);
+}
+
+void Io::_subscribeDevice() {
+    char topic[MQTT_TOPIC_SIZE + 1];
+    byte mac[] = IO_MAC_ADDRESS;
+
+    char* cursor = Text::Copy_P(topic, t_lights_device);
+    for (byte i = 0; i < sizeof(mac); i++)
+        cursor = Text::Hex(cursor, mac[i]);
+    mqtt.subscribe(topic);
+}
+
+void Io::_subscribeGroups(bool subscribe) {
+    char topic[MQTT_TOPIC_SIZE + 1];
+
+    char* cursor = Text::Copy_P(topic, t_lights_group);
+    for (byte group = 0; group < IO_GROUPS_NUMBER; group++) {
+        if (groups & (1 << group)) {
+            cursor[0] = '0' + group;
+            cursor[1] = '\0';
+            if (subscribe)
+                mqtt.subscribe(topic);
+            else
+                mqtt.unsubscribe(topic);
+        }
     }
+}
+
+#endif
+
+void Io::_logIp(LogId id) {
+    IPAddress ip = Ethernet.localIP();
+    byte address[] = { ip[0], ip[1], ip[2], ip[3] };
+    Log::Write(id, address, sizeof(address));
+}
+
+void Io::_clientId(char clientId[]) {
+    byte mac[] = IO_MAC_ADDRESS;
+    char* cursor = Text::Copy_P(clientId, PSTR("light_"));
+
+    for (byte i = 0; i < sizeof(mac); i++) {
+        if (i > 0)
+            *cursor++ = ':';
+        cursor = Text::Hex(cursor, mac[i]);
+    }
+}
+
+#if IO_STATS == 1
 
-    hex[7] = '\0';
-    tb = (byte)strtol(hex+5, NULL, 16);
-    hex[5] = '\0';
-    tg = (byte)strtol(hex+3, NULL, 16);
-    hex[3] = '\0';
-    tr = (byte)strtol(hex+1, NULL, 16);
+void Io::_publishStats() {
+    // "light_xx:xx:xx:xx:xx:xx rx=4294967295 bad=4294967295 saves=65535"
+    char stats[65];
+
+    _clientId(stats);
+    char* cursor = stats + strlen(stats);
+    cursor = Text::Copy_P(cursor, PSTR(" rx="));
+    cursor = Text::Decimal(cursor, statMessages);
+    cursor = Text::Copy_P(cursor, PSTR(" bad="));
+    cursor = Text::Decimal(cursor, statInvalid);
+    cursor = Text::Copy_P(cursor, PSTR(" saves="));
+    Text::Decimal(cursor, Display::GetSaveCount());
+    mqtt.publish_P(t_lights_stats, stats);
+}
+
+#endif
+
+bool Io::_parseColor(const char hex[], byte* r, byte* g, byte* b) {
+    byte tr=0, tg=255, tb=0;
+
+    // For efficiency, we trust here the string is 7 char long. Should be checked above.
+    if (!Text::ParseHex(hex+1, &tr) || !Text::ParseHex(hex+3, &tg) || !Text::ParseHex(hex+5, &tb))
+        return false;
     
     *r = tr;
     *g = tg;
@@ -217,7 +641,7 @@ bool Io::_parseColor(char hex[], byte* r, byte* g, byte* b) {
 #endif
 
 void Io::_nextMode() {
-    currentMode = currentMode >= 7 ? 0 : currentMode + 1;
+    currentMode = currentMode >= IO_MODES_NUMBER - 1 ? 0 : currentMode + 1;
 
     switch (currentMode) {
         case 0:
@@ -244,6 +668,16 @@ void Io::_nextMode() {
         case 7:
             Display::Disco();
             break;
+        #if LEDS_AUDIO == 1
+            case 8:
+                Display::Audio();
+                break;
+        #endif
+        #if LEDS_CLIP == 1
+            case 8 + LEDS_AUDIO:
+                Display::Clip();
+                break;
+        #endif
     }
 
     Display::RequestSaveState();
@@ -255,11 +689,12 @@ void Io::_var() {
 
     #if IO_NETWORKING == 1
         if (mqtt.connected()) {
-            char hex[] = "#000000";
-            sprintf(hex, "#%02X%02X%02X", newColor.r, newColor.g, newColor.b);
-            mqtt.unsubscribe(t_lights_all_color);
-            mqtt.publish(t_lights_all_color, hex);
-            mqtt.subscribe(t_lights_all_color);
+            char hex[8];
+            hex[0] = '#';
+            Text::Hex(Text::Hex(Text::Hex(hex+1, newColor.r), newColor.g), newColor.b);
+            mqtt.unsubscribe_P(t_lights_all_color);
+            mqtt.publish_P(t_lights_all_color, hex);
+            mqtt.subscribe_P(t_lights_all_color);
         }
     #endif
 
@@ -24,6 +24,17 @@
 
 #pragma once
 
+#include "Log.h"
+
+// Address of the cached network configuration in the EEPROM, after the program of the VM (see Vm.h)
+#define IO_LEASE_EEPROM_ADDRESS 80
+
+// Address of the group membership in the EEPROM, after the cached network configuration
+#define IO_GROUPS_EEPROM_ADDRESS 104
+
+// Number of groups a device can be member of (bits of the group mask)
+#define IO_GROUPS_NUMBER 8
+
 
 /**
  * This class handles the user input/output
@@ -40,20 +51,92 @@ private:
     static void _connect();
 
     /**
-     * Callback for the PubSubClient library
+     * Start the ethernet interface, with the cached lease if there is one, or with DHCP
+     */
+    static void _startEthernet();
+
+    /**
+     * Open the connection with the broker and subscribe to the topics
+     * @return true if the broker accepted the connection
+     */
+    static bool _connectBroker();
+
+    /**
+     * Save the current network configuration and the address of the broker to the EEPROM.
+     * Nothing is written if they did not change.
+     */
+    static void _saveLease();
+
+    /**
+     * Replace the cached lease in use by a lease from the DHCP server, which can then be renewed.
+     * The connection with the broker is closed. The cached lease stays in use if the server doesn't answer.
+     */
+    static void _renewLease();
+
+    /**
+     * Invalidate the network configuration saved on the EEPROM
+     */
+    static void _clearLease();
+
+    /**
+     * Callback for the MQTT client
      * Handles incoming messages from the broker
      */
     static void _callback(char* topic, byte* payload, unsigned int length);
 
+    /**
+     * Handle the options following a command (e.g. "42 @05"): trace identifier and group mask
+     * @param options Input string, after the command and its separator
+     * @return false if the command is not meant for this device
+     */
+    static bool _parseOptions(char options[]);
+
+    /**
+     * Load the group membership from the EEPROM
+     */
+    static void _loadGroups();
+
+    /**
+     * Change the group membership, save it to the EEPROM and update the subscriptions
+     * @param mask One bit per group
+     */
+    static void _setGroups(byte mask);
+
+    /**
+     * Subscribe to the topic of the device. It never changes, so it is only subscribed on connection.
+     */
+    static void _subscribeDevice();
+
+    /**
+     * Subscribe to the topics of the groups of the device, or unsubscribe from them
+     */
+    static void _subscribeGroups(bool subscribe);
+
+    /**
+     * Write the identifier of the device on the broker ("light_xx:xx:xx:xx:xx:xx")
+     * @param clientId Output string, at least 24 characters long
+     */
+    static void _clientId(char clientId[]);
+
+    /**
+     * Log a message with the IP address of the device
+     */
+    static void _logIp(LogId id);
+
+    /**
+     * Publish the message counters on the stats topic
+     */
+    static void _publishStats();
+
     /**
      * Parse a color in hexadecimal format
-     * @param hex Input string (e.g. "#f0abe5"). Case insensitive. Will be modified.
+     * @param hex Input string (e.g. "#f0abe5"). Case insensitive.
      * @param r Output red value
      * @param g Output green value
      * @param b Output blue value
      * @return true if the parsing is successful
      */
-    static bool _parseColor(char hex[], byte* r, byte* g, byte* b);
+    static bool _parseColor(const char hex[], byte* r, byte* g, byte* b);
 
     /**
      * Change to the next mode
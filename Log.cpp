@@ -0,0 +1,92 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+
+#include "Log.h"
+
+// First byte of every record, used by the decoder to find the start of the records
+#define LOG_SYNC 0xA5
+
+// Sync byte, identifier and length
+#define LOG_HEADER_SIZE 3
+
+
+void Log::Task(void *pvParameters) {
+    for (;;) {
+        if (_dropped > 0) {
+            taskENTER_CRITICAL();
+            byte dropped = _dropped;
+            _dropped = 0;
+            taskEXIT_CRITICAL();
+
+            Write(LogId::Dropped, &dropped, sizeof(dropped));
+        }
+
+        // Only this task moves the tail, the writers only read it
+        while (_tail != _head) {
+            Serial.write(_buffer[_tail & (LOG_BUFFER_SIZE - 1)]);
+            _tail++;
+        }
+
+        vTaskDelay(LOG_DELAY / portTICK_PERIOD_MS);
+    }
+}
+
+void Log::Write(LogId id) {
+    Write(id, NULL, 0);
+}
+
+void Log::Write(LogId id, uint16_t value) {
+    Write(id, &value, sizeof(value));
+}
+
+void Log::Write(LogId id, const void* data, byte length) {
+    // No lock is taken: the interrupts are only masked while the few bytes of the record are copied
+    taskENTER_CRITICAL();
+
+    if ((byte)(_head - _tail) + LOG_HEADER_SIZE + length > LOG_BUFFER_SIZE) {
+        if (_dropped < 255)
+            _dropped++;
+    }
+    else {
+        _buffer[_head++ & (LOG_BUFFER_SIZE - 1)] = LOG_SYNC;
+        _buffer[_head++ & (LOG_BUFFER_SIZE - 1)] = (byte)id;
+        _buffer[_head++ & (LOG_BUFFER_SIZE - 1)] = length;
+
+        for (byte i = 0; i < length; i++)
+            _buffer[_head++ & (LOG_BUFFER_SIZE - 1)] = ((const byte*)data)[i];
+    }
+
+    taskEXIT_CRITICAL();
+}
+
+byte Log::_buffer[LOG_BUFFER_SIZE];
+
+volatile byte Log::_head = 0;
+
+volatile byte Log::_tail = 0;
+
+volatile byte Log::_dropped = 0;
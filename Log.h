@@ -0,0 +1,131 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// Size of the ring buffer holding the records until they are sent (must be a power of 2, up to 128)
+#define LOG_BUFFER_SIZE 64
+
+// Time between two flushes of the ring buffer, in milliseconds
+#define LOG_DELAY 30
+
+/*
+ * Catalog of the log messages: identifier and text, in the printf format.
+ * Only %hhu (1 byte), %u (2 bytes), %lu (4 bytes) and a final %s are supported.
+ * tools/log_decode.py reads this list to turn the records back into text:
+ * append the new messages at the end to keep the identifiers of the old ones.
+ */
+#define LOG_MESSAGES(X) \
+    X(Boot,             "AtmoLight") \
+    X(Dropped,          "(%hhu log records dropped)") \
+    X(TimesUp,          "Time's up") \
+    X(SolidColor,       "SolidColor") \
+    X(Pulse,            "Pulse") \
+    X(Rainbow,          "Rainbow") \
+    X(Fire,             "Fire") \
+    X(Aurora,           "Aurora") \
+    X(Disco,            "Disco") \
+    X(Program,          "Program") \
+    X(Audio,            "Audio") \
+    X(Adalight,         "Adalight") \
+    X(AdalightTimeout,  "Adalight timeout") \
+    X(SwitchOff,        "SwitchOff") \
+    X(SetRemainingTime, "SetRemainingTime:%u") \
+    X(SetColor,         "SetColor %hhu %hhu %hhu") \
+    X(SavingState,      "Saving state to EEPROM") \
+    X(LoadingState,     "Loading state from EEPROM") \
+    X(NoState,          "No data on EEPROM") \
+    X(Connecting,       "Connecting eth...") \
+    X(EthFailed,        "eth failed %hhu.%hhu.%hhu.%hhu") \
+    X(DhcpAssigned,     "DHCP assigned IP %hhu.%hhu.%hhu.%hhu") \
+    X(ConnectingBroker, "Trying to connect to the broker...") \
+    X(Connected,        "Connected to broker") \
+    X(ConnectionFailed, "Failed to connect to broker") \
+    X(InvalidProgram,   "Invalid program") \
+    X(InTopic,          "In msg [%s]") \
+    X(InPayload,        "  %s") \
+    X(Clip,             "Clip") \
+    X(NoClip,           "No clip on the SD card") \
+    X(LeaseCached,      "Cached lease IP %hhu.%hhu.%hhu.%hhu") \
+    X(LeaseStale,       "Cached lease rejected, asking the DHCP server") \
+    X(FirstFrame,       "First frame at %lu ms") \
+    X(BrokerReady,      "Broker connected at %lu ms") \
+    X(LeaseRenewal,     "Asking the DHCP server to renew the cached lease")
+
+/**
+ * Identifier of a log message
+ */
+enum class LogId : byte {
+    #define LOG_ID(name, text) name,
+    LOG_MESSAGES(LOG_ID)
+    #undef LOG_ID
+};
+
+
+/**
+ * Deferred binary logger
+ * The tasks only copy a compact record (message identifier and raw arguments) into a ring buffer,
+ * which takes the same short time whatever the message. The Log task sends the records on the
+ * serial port in the background. tools/log_decode.py turns them back into text.
+ */
+class Log {
+public:
+    static void Task(void *pvParameters);
+
+    /**
+     * Log a message without argument
+     */
+    static void Write(LogId id);
+
+    /**
+     * Log a message with a 16-bit argument
+     */
+    static void Write(LogId id, uint16_t value);
+
+    /**
+     * Log a message with raw arguments, in the order of the format
+     * @param data Arguments, as stored in memory (little endian)
+     * @param length Size of the arguments, in bytes
+     */
+    static void Write(LogId id, const void* data, byte length);
+
+private:
+    /**
+     * Records waiting to be sent
+     */
+    static byte _buffer[LOG_BUFFER_SIZE];
+
+    /**
+     * Free running positions of the writers and the reader. Only their difference is meaningful.
+     */
+    static volatile byte _head;
+    static volatile byte _tail;
+
+    /**
+     * Number of records dropped because the buffer was full
+     */
+    static volatile byte _dropped;
+};
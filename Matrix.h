@@ -0,0 +1,156 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#if LEDS_MATRIX == 1
+
+static_assert(LEDS_MATRIX_WIDTH * LEDS_MATRIX_HEIGHT == LEDS_NUMBER, "The matrix must have LEDS_NUMBER leds");
+
+// Size of the matrix as displayed, once rotated
+#if LEDS_MATRIX_ROTATION == 90 || LEDS_MATRIX_ROTATION == 270
+    #define MATRIX_WIDTH LEDS_MATRIX_HEIGHT
+    #define MATRIX_HEIGHT LEDS_MATRIX_WIDTH
+#else
+    #define MATRIX_WIDTH LEDS_MATRIX_WIDTH
+    #define MATRIX_HEIGHT LEDS_MATRIX_HEIGHT
+#endif
+
+// Smallest type able to hold an index of the strip
+#if LEDS_NUMBER <= 256
+    typedef uint8_t MatrixIndex;
+#else
+    typedef uint16_t MatrixIndex;
+#endif
+
+
+/**
+ * Maps the pixels of a matrix to the leds of the strip.
+ * The pixels are numbered row by row, from the bottom left corner, as seen once the matrix is rotated and mirrored.
+ * The mapping is computed by the compiler and stored as a table in flash memory.
+ */
+class Matrix {
+public:
+    /**
+     * @param pixel Number of the pixel (y * MATRIX_WIDTH + x)
+     * @return Index of the pixel in the strip
+     */
+    static inline uint16_t Index(uint16_t pixel);
+
+    /**
+     * Compute the index of a pixel in the strip. Only meant to build the table.
+     */
+    static constexpr uint16_t Map(uint16_t pixel) {
+        return _wire(_mirrorX(pixel % MATRIX_WIDTH), _mirrorY(pixel / MATRIX_WIDTH));
+    }
+
+private:
+    static constexpr uint16_t _mirrorX(uint16_t x) {
+        return LEDS_MATRIX_MIRROR_X ? MATRIX_WIDTH - 1 - x : x;
+    }
+
+    static constexpr uint16_t _mirrorY(uint16_t y) {
+        return LEDS_MATRIX_MIRROR_Y ? MATRIX_HEIGHT - 1 - y : y;
+    }
+
+    /**
+     * Index in the strip of the displayed pixel (x, y)
+     */
+    static constexpr uint16_t _wire(uint16_t x, uint16_t y) {
+        return _serpentine(_physicalX(x, y), _physicalY(x, y));
+    }
+
+    /**
+     * Column of the pixel (x, y) on the wiring, before the rotation
+     */
+    static constexpr uint16_t _physicalX(uint16_t x, uint16_t y) {
+        return LEDS_MATRIX_ROTATION == 90 ? y
+            : LEDS_MATRIX_ROTATION == 180 ? LEDS_MATRIX_WIDTH - 1 - x
+            : LEDS_MATRIX_ROTATION == 270 ? LEDS_MATRIX_WIDTH - 1 - y
+            : x;
+    }
+
+    /**
+     * Row of the pixel (x, y) on the wiring, before the rotation
+     */
+    static constexpr uint16_t _physicalY(uint16_t x, uint16_t y) {
+        return LEDS_MATRIX_ROTATION == 90 ? LEDS_MATRIX_HEIGHT - 1 - x
+            : LEDS_MATRIX_ROTATION == 180 ? LEDS_MATRIX_HEIGHT - 1 - y
+            : LEDS_MATRIX_ROTATION == 270 ? x
+            : y;
+    }
+
+    /**
+     * On serpentine wirings, every other row goes backwards
+     */
+    static constexpr uint16_t _serpentine(uint16_t x, uint16_t y) {
+        return y * LEDS_MATRIX_WIDTH + ((LEDS_MATRIX_SERPENTINE && (y & 1)) ? LEDS_MATRIX_WIDTH - 1 - x : x);
+    }
+};
+
+
+/**
+ * Compile-time list of pixel numbers, used to generate the table
+ */
+template<uint16_t... Pixels>
+struct MatrixPixels {};
+
+template<uint16_t N, uint16_t... Pixels>
+struct MatrixSequence : MatrixSequence<N - 1, N - 1, Pixels...> {};
+
+template<uint16_t... Pixels>
+struct MatrixSequence<0, Pixels...> {
+    typedef MatrixPixels<Pixels...> type;
+};
+
+/**
+ * Table of the strip index of every pixel, in flash memory
+ */
+template<typename T>
+struct MatrixTable;
+
+template<uint16_t... Pixels>
+struct MatrixTable<MatrixPixels<Pixels...>> {
+    static const MatrixIndex values[sizeof...(Pixels)];
+};
+
+template<uint16_t... Pixels>
+const MatrixIndex MatrixTable<MatrixPixels<Pixels...>>::values[sizeof...(Pixels)] PROGMEM = { (MatrixIndex)Matrix::Map(Pixels)... };
+
+typedef MatrixTable<MatrixSequence<LEDS_NUMBER>::type> MatrixXY;
+
+
+inline uint16_t Matrix::Index(uint16_t pixel) {
+    #if LEDS_NUMBER <= 256
+        return pgm_read_byte(&MatrixXY::values[pixel]);
+    #else
+        return pgm_read_word(&MatrixXY::values[pixel]);
+    #endif
+}
+
+#endif
@@ -0,0 +1,356 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+
+#include "Mqtt.h"
+
+// Control packet types (MQTT 3.1.1, section 2.2.1), including the mandatory flags
+#define MQTT_CONNECT     0x10
+#define MQTT_CONNACK     0x20
+#define MQTT_PUBLISH     0x30
+#define MQTT_SUBSCRIBE   0x82
+#define MQTT_UNSUBSCRIBE 0xA2
+#define MQTT_PINGREQ     0xC0
+#define MQTT_PINGRESP    0xD0
+#define MQTT_DISCONNECT  0xE0
+
+
+Mqtt::Mqtt(Client& client) {
+    _client = &client;
+    _host = NULL;
+    _port = 1883;
+    _callback = NULL;
+    _nextPacketId = 1;
+    _pingOutstanding = false;
+    _lastOutActivity = 0;
+    _lastInActivity = 0;
+}
+
+void Mqtt::setServer(const char* host, uint16_t port) {
+    _host = host;
+    _port = port;
+}
+
+void Mqtt::setServer(IPAddress ip, uint16_t port) {
+    _host = NULL;
+    _ip = ip;
+    _port = port;
+}
+
+void Mqtt::setCallback(MqttCallback callback) {
+    _callback = callback;
+}
+
+bool Mqtt::connect(const char* clientId) {
+    int opened = _host != NULL ? _client->connect(_host, _port) : _client->connect(_ip, _port);
+    if (!opened)
+        return false;
+
+    // Protocol name, level 4 (3.1.1), clean session flag and keepalive
+    const byte variableHeader[] = {
+        0x00, 0x04, 'M', 'Q', 'T', 'T',
+        0x04,
+        0x02,
+        MQTT_KEEPALIVE >> 8, MQTT_KEEPALIVE & 0xFF
+    };
+    uint16_t idLength = strlen(clientId);
+
+    byte packet[MQTT_PACKET_SIZE];
+    byte size = _packHeader(packet, MQTT_CONNECT, sizeof(variableHeader) + 2 + idLength);
+    size = _pack(packet, size, variableHeader, sizeof(variableHeader), false);
+    size = _packString(packet, size, clientId, idLength, false);
+    _client->write(packet, size);
+    _lastOutActivity = millis();
+
+    // Wait for the broker to acknowledge
+    byte type = 0;
+    uint32_t length = 0;
+    byte ack[2] = { 0, 0xFF };
+
+    if (_readHeader(&type, &length) && type == MQTT_CONNACK && length == 2 && _readInto(ack, 2, 2) && ack[1] == 0) {
+        _lastInActivity = millis();
+        _pingOutstanding = false;
+        return true;
+    }
+
+    _client->stop();
+    return false;
+}
+
+void Mqtt::disconnect() {
+    if (_client->connected())
+        _sendEmpty(MQTT_DISCONNECT);
+
+    _client->stop();
+}
+
+bool Mqtt::connected() {
+    return _client->connected();
+}
+
+bool Mqtt::publish(const char* topic, const char* payload) {
+    return _publish(topic, false, payload);
+}
+
+bool Mqtt::publish_P(PGM_P topic, const char* payload) {
+    return _publish(topic, true, payload);
+}
+
+bool Mqtt::subscribe(const char* topic) {
+    return _subscription(MQTT_SUBSCRIBE, topic, false);
+}
+
+bool Mqtt::unsubscribe(const char* topic) {
+    return _subscription(MQTT_UNSUBSCRIBE, topic, false);
+}
+
+bool Mqtt::subscribe_P(PGM_P topic) {
+    return _subscription(MQTT_SUBSCRIBE, topic, true);
+}
+
+bool Mqtt::unsubscribe_P(PGM_P topic) {
+    return _subscription(MQTT_UNSUBSCRIBE, topic, true);
+}
+
+bool Mqtt::loop() {
+    if (!connected())
+        return false;
+
+    // Keepalive: ping the broker when the line has been quiet for too long
+    unsigned long now = millis();
+    if (now - _lastInActivity >= MQTT_KEEPALIVE * 1000UL || now - _lastOutActivity >= MQTT_KEEPALIVE * 1000UL) {
+        // The previous ping have not been answered, the broker is gone
+        if (_pingOutstanding) {
+            _client->stop();
+            return false;
+        }
+
+        _sendEmpty(MQTT_PINGREQ);
+        _lastOutActivity = now;
+        _lastInActivity = now;
+        _pingOutstanding = true;
+    }
+
+    for (byte i = 0; i < MQTT_LOOP_PACKETS && _client->available(); i++) {
+        if (!_readPacket()) {
+            _client->stop();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Mqtt::_readByte(byte* value) {
+    unsigned long start = millis();
+
+    while (!_client->available()) {
+        if (millis() - start >= MQTT_SOCKET_TIMEOUT || !_client->connected())
+            return false;
+    }
+
+    *value = _client->read();
+    return true;
+}
+
+bool Mqtt::_readHeader(byte* type, uint32_t* length) {
+    byte digit = 0;
+    uint32_t multiplier = 1;
+
+    if (!_readByte(type))
+        return false;
+
+    // The remaining length is encoded on 1 to 4 bytes, 7 bits at a time
+    *length = 0;
+    for (byte i = 0; i < 4; i++) {
+        if (!_readByte(&digit))
+            return false;
+
+        *length += (digit & 0x7F) * multiplier;
+        multiplier <<= 7;
+
+        if ((digit & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+bool Mqtt::_readInto(byte* buffer, uint32_t size, uint32_t length) {
+    byte value = 0;
+
+    for (uint32_t i = 0; i < length; i++) {
+        if (!_readByte(&value))
+            return false;
+
+        if (buffer != NULL && i < size)
+            buffer[i] = value;
+    }
+
+    return true;
+}
+
+bool Mqtt::_readPacket() {
+    byte type = 0;
+    uint32_t length = 0;
+
+    if (!_readHeader(&type, &length))
+        return false;
+
+    _lastInActivity = millis();
+
+    switch (type & 0xF0) {
+        case MQTT_PUBLISH: {
+            byte topicLengthBytes[2];
+            if (length < 2 || !_readInto(topicLengthBytes, 2, 2))
+                return false;
+
+            uint16_t topicLength = (topicLengthBytes[0] << 8) | topicLengthBytes[1];
+            if (topicLength > length - 2)
+                return false;
+
+            if (!_readInto((byte*)_topic, MQTT_TOPIC_SIZE, topicLength))
+                return false;
+            _topic[min(topicLength, MQTT_TOPIC_SIZE)] = '\0';
+            length -= 2 + topicLength;
+
+            // QoS 1 and 2 messages carry a packet identifier.
+            // Subscriptions are made with QoS 0 so the broker should never send any, just skip it.
+            if (type & 0x06) {
+                if (length < 2 || !_readInto(NULL, 0, 2))
+                    return false;
+                length -= 2;
+            }
+
+            if (!_readInto(_payload, MQTT_PAYLOAD_SIZE, length))
+                return false;
+            _payload[min(length, (uint32_t)MQTT_PAYLOAD_SIZE)] = '\0';
+
+            if (_callback != NULL)
+                _callback(_topic, _payload, length);
+
+            return true;
+        }
+
+        case MQTT_PINGREQ:
+            _sendEmpty(MQTT_PINGRESP);
+            _lastOutActivity = millis();
+            return _readInto(NULL, 0, length);
+
+        case MQTT_PINGRESP:
+            _pingOutstanding = false;
+            return _readInto(NULL, 0, length);
+
+        default:
+            // CONNACK, SUBACK, UNSUBACK... Nothing to do with them
+            return _readInto(NULL, 0, length);
+    }
+}
+
+byte Mqtt::_packHeader(byte packet[], byte type, uint16_t length) {
+    byte size = 0;
+
+    packet[size++] = type;
+
+    do {
+        byte digit = length & 0x7F;
+        length >>= 7;
+        if (length > 0)
+            digit |= 0x80;
+        packet[size++] = digit;
+    } while (length > 0);
+
+    return size;
+}
+
+byte Mqtt::_pack(byte packet[], byte size, const byte* data, uint16_t length, bool progmem) {
+    for (uint16_t i = 0; i < length; i++) {
+        // A packet larger than the buffer goes out in several writes
+        if (size == MQTT_PACKET_SIZE) {
+            _client->write(packet, size);
+            size = 0;
+        }
+
+        packet[size++] = progmem ? pgm_read_byte(&data[i]) : data[i];
+    }
+
+    return size;
+}
+
+byte Mqtt::_packString(byte packet[], byte size, const char* value, uint16_t length, bool progmem) {
+    const byte prefix[] = { (byte)(length >> 8), (byte)(length & 0xFF) };
+
+    size = _pack(packet, size, prefix, 2, false);
+    return _pack(packet, size, (const byte*)value, length, progmem);
+}
+
+void Mqtt::_sendEmpty(byte type) {
+    const byte packet[] = { type, 0x00 };
+    _client->write(packet, sizeof(packet));
+}
+
+bool Mqtt::_publish(const char* topic, bool progmem, const char* payload) {
+    if (!connected())
+        return false;
+
+    uint16_t topicLength = progmem ? strlen_P(topic) : strlen(topic);
+    uint16_t payloadLength = strlen(payload);
+
+    byte packet[MQTT_PACKET_SIZE];
+    byte size = _packHeader(packet, MQTT_PUBLISH, 2 + topicLength + payloadLength);
+    size = _packString(packet, size, topic, topicLength, progmem);
+    size = _pack(packet, size, (const byte*)payload, payloadLength, false);
+    _client->write(packet, size);
+    _lastOutActivity = millis();
+
+    return true;
+}
+
+bool Mqtt::_subscription(byte type, const char* topic, bool progmem) {
+    if (!connected())
+        return false;
+
+    uint16_t topicLength = progmem ? strlen_P(topic) : strlen(topic);
+    uint16_t packetId = _nextPacketId++;
+
+    // Packet identifiers must be non-zero
+    if (_nextPacketId == 0)
+        _nextPacketId = 1;
+
+    // Packet identifier, topic filter and, for SUBSCRIBE only, the requested QoS
+    const byte packetIdBytes[] = { (byte)(packetId >> 8), (byte)(packetId & 0xFF) };
+    const byte qos = 0;
+
+    byte packet[MQTT_PACKET_SIZE];
+    byte size = _packHeader(packet, type, 2 + 2 + topicLength + (type == MQTT_SUBSCRIBE ? 1 : 0));
+    size = _pack(packet, size, packetIdBytes, 2, false);
+    size = _packString(packet, size, topic, topicLength, progmem);
+    if (type == MQTT_SUBSCRIBE)
+        size = _pack(packet, size, &qos, 1, false);
+    _client->write(packet, size);
+    _lastOutActivity = millis();
+
+    return true;
+}
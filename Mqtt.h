@@ -0,0 +1,225 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+
+#include "config.h"
+
+// Keepalive interval announced to the broker, in seconds
+#define MQTT_KEEPALIVE 15
+
+// Time to wait for the broker to answer, in milliseconds
+#define MQTT_SOCKET_TIMEOUT 5000
+
+// Most packets handled by one call of loop(). The others wait for the next call, so a burst of
+// messages doesn't keep the caller (and the SPI bus) away from its other duties.
+#define MQTT_LOOP_PACKETS 4
+
+// Longest topic kept from an incoming message. Longer topics are truncated.
+#define MQTT_TOPIC_SIZE 24
+
+// Buffer on the stack where an outgoing packet is built, so it goes out in one write (one SEND of
+// the Ethernet chip). Enough for any packet of AtmoLight, larger ones are written in several pieces.
+#define MQTT_PACKET_SIZE 96
+
+// Longest payload kept from an incoming message. The remaining bytes are discarded.
+// Large enough for a program of the VM (see Vm.h), or else for a color and its options ("#xxxxxx 65535 @ff").
+#if LEDS_PROGRAM == 1
+    #define MQTT_PAYLOAD_SIZE 32
+#else
+    #define MQTT_PAYLOAD_SIZE 20
+#endif
+
+/**
+ * Signature of the function called for every message received.
+ * topic and payload are null terminated. length is the real payload length,
+ * it can be greater than MQTT_PAYLOAD_SIZE if the payload have been truncated.
+ */
+typedef void (*MqttCallback)(char* topic, byte* payload, unsigned int length);
+
+
+/**
+ * Minimal MQTT 3.1.1 client
+ * Only covers what AtmoLight needs: connect, keepalive, subscribe and QoS 0 publish.
+ * Incoming packets are parsed directly from the socket, so only the topic and the
+ * first bytes of the payload are held in memory.
+ */
+class Mqtt {
+public:
+    Mqtt(Client& client);
+
+    /**
+     * Set the address of the broker. host must stay valid as long as the client is used.
+     */
+    void setServer(const char* host, uint16_t port);
+
+    /**
+     * Set the address of the broker, already resolved. Skips the DNS lookup on connection.
+     */
+    void setServer(IPAddress ip, uint16_t port);
+
+    /**
+     * Set the function called for every incoming message
+     */
+    void setCallback(MqttCallback callback);
+
+    /**
+     * Open the connection with the broker
+     * @param clientId Identifier of the device. Must be unique on the broker.
+     * @return true if the broker accepted the connection
+     */
+    bool connect(const char* clientId);
+
+    /**
+     * Close the connection with the broker
+     */
+    void disconnect();
+
+    /**
+     * @return true if the connection with the broker is active
+     */
+    bool connected();
+
+    /**
+     * Publish a message with QoS 0
+     */
+    bool publish(const char* topic, const char* payload);
+
+    /**
+     * Same as publish, with the topic stored in the program memory
+     */
+    bool publish_P(PGM_P topic, const char* payload);
+
+    /**
+     * Subscribe to a topic with QoS 0
+     */
+    bool subscribe(const char* topic);
+
+    /**
+     * Same as subscribe, with the topic stored in the program memory
+     */
+    bool subscribe_P(PGM_P topic);
+
+    /**
+     * Unsubscribe from a topic
+     */
+    bool unsubscribe(const char* topic);
+
+    /**
+     * Same as unsubscribe, with the topic stored in the program memory
+     */
+    bool unsubscribe_P(PGM_P topic);
+
+    /**
+     * Handle the incoming messages, up to MQTT_LOOP_PACKETS, and keep the connection alive.
+     * Must be called regularly.
+     * @return false if the connection is lost
+     */
+    bool loop();
+
+private:
+    Client* _client;
+    const char* _host; // NULL when the broker is set by its IP address
+    IPAddress _ip;
+    uint16_t _port;
+    MqttCallback _callback;
+    uint16_t _nextPacketId;
+    bool _pingOutstanding;
+
+    /**
+     * Timestamps of the last packets sent and received, used for the keepalive
+     */
+    unsigned long _lastOutActivity;
+    unsigned long _lastInActivity;
+
+    /**
+     * Buffers receiving the topic and payload of an incoming message
+     */
+    char _topic[MQTT_TOPIC_SIZE + 1];
+    byte _payload[MQTT_PAYLOAD_SIZE + 1];
+
+    /**
+     * Read one byte from the socket, waiting up to MQTT_SOCKET_TIMEOUT
+     * @return false on timeout
+     */
+    bool _readByte(byte* value);
+
+    /**
+     * Read the fixed header of a packet
+     * @param type Output packet type and flags (first byte)
+     * @param length Output remaining length
+     * @return false on timeout or malformed header
+     */
+    bool _readHeader(byte* type, uint32_t* length);
+
+    /**
+     * Read length bytes from the socket. Keeps the first size bytes in buffer and drops the others.
+     * buffer can be NULL to drop everything.
+     */
+    bool _readInto(byte* buffer, uint32_t size, uint32_t length);
+
+    /**
+     * Read and dispatch one incoming packet
+     */
+    bool _readPacket();
+
+    /**
+     * Put the fixed header of a packet at the start of the packet buffer
+     * @return Size of the header
+     */
+    byte _packHeader(byte packet[], byte type, uint16_t length);
+
+    /**
+     * Append bytes to the packet buffer. When the buffer is full, it is written and starts over.
+     * @param size Bytes already in the buffer
+     * @param progmem true if data is stored in the program memory
+     * @return Bytes in the buffer after the append
+     */
+    byte _pack(byte packet[], byte size, const byte* data, uint16_t length, bool progmem);
+
+    /**
+     * Append a string prefixed by its length, as defined by the protocol
+     */
+    byte _packString(byte packet[], byte size, const char* value, uint16_t length, bool progmem);
+
+    /**
+     * Send a packet without any content (PINGREQ, PINGRESP, DISCONNECT)
+     */
+    void _sendEmpty(byte type);
+
+    /**
+     * Send a PUBLISH packet
+     * @param progmem true if the topic is stored in the program memory
+     */
+    bool _publish(const char* topic, bool progmem, const char* payload);
+
+    /**
+     * Send a SUBSCRIBE or UNSUBSCRIBE packet
+     * @param progmem true if the topic is stored in the program memory
+     */
+    bool _subscription(byte type, const char* topic, bool progmem);
+};
@@ -0,0 +1,79 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <semphr.h>
+#define FASTLED_INTERNAL
+#include <FastLED.h>
+
+#include "Output.h"
+#include "config.h"
+
+#if IO_TRACE == 1
+    #include "Trace.h"
+#endif
+
+
+void Output::Init() {
+    _ready = xSemaphoreCreateBinary();
+    _done = xSemaphoreCreateBinary();
+
+    // Nothing is being clocked out yet
+    xSemaphoreGive(_done);
+}
+
+void Output::Task(void *pvParameters) {
+    for (;;) {
+        xSemaphoreTake(_ready, portMAX_DELAY);
+
+        #if IO_TRACE == 1
+            Trace::ShowStart();
+        #endif
+
+        FastLED.show();
+
+        #if IO_TRACE == 1
+            Trace::ShowEnd();
+        #endif
+
+        xSemaphoreGive(_done);
+    }
+}
+
+void Output::Show(const CRGB* frame) {
+    xSemaphoreTake(_done, portMAX_DELAY);
+    memcpy(_frame, frame, sizeof(_frame));
+    xSemaphoreGive(_ready);
+}
+
+CRGB* Output::GetFrame() {
+    return _frame;
+}
+
+CRGB Output::_frame[LEDS_NUMBER];
+
+SemaphoreHandle_t Output::_ready = NULL;
+
+SemaphoreHandle_t Output::_done = NULL;
@@ -0,0 +1,79 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino_FreeRTOS.h>
+#include <semphr.h>
+#define FASTLED_INTERNAL
+#include <FastLED.h>
+
+#include "config.h"
+
+
+/**
+ * Second stage of the double-buffered pipeline (LEDS_DOUBLE_BUFFER)
+ * The Display task renders into its strip while the previous frame is clocked out
+ * from a copy of it by the Output task. The copy is only overwritten once the leds
+ * have received all of it, so a frame is never torn.
+ */
+class Output {
+public:
+    /**
+     * Create the semaphores. Must be called before the tasks are started.
+     */
+    static void Init();
+
+    /**
+     * Clock out the frames handed over by Show
+     */
+    static void Task(void *pvParameters);
+
+    /**
+     * Wait for the previous frame to be out, then hand over a new one (Display task)
+     * @param frame Leds to show. They are copied, so the rendering of the next frame can start right away.
+     */
+    static void Show(const CRGB* frame);
+
+    /**
+     * @return The buffer the leds are clocked out from, to register on FastLED
+     */
+    static CRGB* GetFrame();
+
+private:
+    /**
+     * Frame being clocked out
+     */
+    static CRGB _frame[LEDS_NUMBER];
+
+    /**
+     * Given when a new frame is in _frame
+     */
+    static SemaphoreHandle_t _ready;
+
+    /**
+     * Given when _frame have been clocked out and can be overwritten
+     */
+    static SemaphoreHandle_t _done;
+};
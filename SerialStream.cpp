@@ -0,0 +1,99 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#define FASTLED_INTERNAL
+#include <FastLED.h>
+
+#include "SerialStream.h"
+
+#define STATE_COUNT_HIGH 3
+#define STATE_COUNT_LOW 4
+#define STATE_CHECKSUM 5
+#define STATE_DATA 6
+
+static const char magicWord[] PROGMEM = "Ada";
+
+
+bool SerialStream::Decode(byte value, CRGB* leds, uint16_t count) {
+    switch (_state) {
+        case STATE_COUNT_HIGH:
+            _countHigh = value;
+            _state++;
+            return false;
+
+        case STATE_COUNT_LOW:
+            _countLow = value;
+            _state++;
+            return false;
+
+        case STATE_CHECKSUM:
+            if (value == (_countHigh ^ _countLow ^ 0x55) && ((uint16_t)_countHigh << 8 | _countLow) < SERIAL_STREAM_MAX_LEDS) {
+                _index = 0;
+                _length = (((uint16_t)_countHigh << 8 | _countLow) + 1) * 3;
+                _state = STATE_DATA;
+            }
+            else {
+                // Wrong header: look for the next magic word
+                _state = (value == pgm_read_byte(&magicWord[0])) ? 1 : 0;
+            }
+            return false;
+
+        case STATE_DATA:
+            // CRGB is 3 bytes (r, g, b) just like the stream, so the leds can be filled byte by byte
+            if (_index < count * 3)
+                ((byte*)leds)[_index] = value;
+
+            if (++_index < _length)
+                return false;
+
+            _state = 0;
+            return true;
+
+        default:
+            if (value == pgm_read_byte(&magicWord[_state]))
+                _state++;
+            else
+                _state = (value == pgm_read_byte(&magicWord[0])) ? 1 : 0;
+            return false;
+    }
+}
+
+bool SerialStream::InFrame() {
+    return _state == STATE_DATA;
+}
+
+void SerialStream::Reset() {
+    _state = 0;
+}
+
+byte SerialStream::_state = 0;
+
+byte SerialStream::_countHigh = 0;
+
+byte SerialStream::_countLow = 0;
+
+uint16_t SerialStream::_index = 0;
+
+uint16_t SerialStream::_length = 0;
@@ -0,0 +1,83 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#define FASTLED_INTERNAL
+#include <FastLED.h>
+
+// Largest number of leds a frame can announce: the length of the frame in bytes must fit in 16 bits.
+// Headers announcing more are considered wrong.
+#define SERIAL_STREAM_MAX_LEDS (0xFFFF / 3)
+
+
+/**
+ * Decoder for the Adalight serial protocol
+ * A frame is made of the "Ada" magic word, the number of leds minus one (2 bytes, big endian),
+ * a checksum (high byte ^ low byte ^ 0x55) then 3 bytes (r, g, b) per led.
+ * The bytes are decoded one at a time, directly into the leds array.
+ */
+class SerialStream {
+public:
+    /**
+     * Decode one byte of the stream
+     * @param value Byte received
+     * @param leds Array receiving the colors
+     * @param count Size of the leds array. Extra leds sent by the computer are ignored.
+     * @return true when a complete frame have been received
+     */
+    static bool Decode(byte value, CRGB* leds, uint16_t count);
+
+    /**
+     * @return true if a valid header have been received and the colors are being decoded
+     */
+    static bool InFrame();
+
+    /**
+     * Drop the current frame and wait for the next header
+     */
+    static void Reset();
+
+private:
+    /**
+     * Position in the frame: 0 to 2 for the magic word, then high byte, low byte, checksum and data
+     */
+    static byte _state;
+
+    /**
+     * Number of leds minus one, as announced in the header
+     */
+    static byte _countHigh;
+    static byte _countLow;
+
+    /**
+     * Index of the next color byte in the frame
+     */
+    static uint16_t _index;
+
+    /**
+     * Number of color bytes in the frame
+     */
+    static uint16_t _length;
+};
@@ -0,0 +1,80 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#define FASTLED_INTERNAL
+#include <FastLED.h>
+
+#include "Spectrum.h"
+
+/*
+ * Goertzel coefficients in Q14: 2 * cos(2 * pi * k / SPECTRUM_SAMPLES) * 16384
+ * k = 2, 4, 8, 16, 24, 31 gives 125 Hz, 250 Hz, 500 Hz, 1 kHz, 1.5 kHz and 1.9 kHz
+ */
+static const int16_t coefficients[SPECTRUM_BANDS] PROGMEM = { 32138, 30274, 23170, 0, -23170, -32610 };
+
+
+void Spectrum::Analyze(byte pin) {
+    int16_t coeffs[SPECTRUM_BANDS];
+    int32_t s1[SPECTRUM_BANDS] = { 0 };
+    int32_t s2[SPECTRUM_BANDS] = { 0 };
+
+    for (byte b = 0; b < SPECTRUM_BANDS; b++)
+        coeffs[b] = pgm_read_word(&coefficients[b]);
+
+    unsigned long nextSample = micros();
+
+    for (byte n = 0; n < SPECTRUM_SAMPLES; n++) {
+        while ((long)(micros() - nextSample) < 0);
+        nextSample += SPECTRUM_SAMPLE_PERIOD;
+
+        // Remove the microphone bias and keep 8 bits, so the filters can't overflow
+        int16_t x = (analogRead(pin) - 512) >> 2;
+
+        for (byte b = 0; b < SPECTRUM_BANDS; b++) {
+            int32_t s0 = x + ((coeffs[b] * s1[b]) >> 14) - s2[b];
+            s2[b] = s1[b];
+            s1[b] = s0;
+        }
+    }
+
+    for (byte b = 0; b < SPECTRUM_BANDS; b++) {
+        // Squared magnitude of the bin. At most (64 * 128 / 2)^2 for a full scale sine, but the terms
+        // are not: the filters reach 53000 on the 1.9 kHz band, so they are squared on 64 bits.
+        int64_t power = (int64_t)s1[b] * s1[b] + (int64_t)s2[b] * s2[b] - (int64_t)((coeffs[b] * s1[b]) >> 14) * s2[b];
+        if (power < 0)
+            power = 0;
+
+        uint64_t scaled = (uint64_t)power >> 8;
+        uint8_t level = scaled > 0xFFFF ? 255 : sqrt16(scaled);
+
+        _levels[b] = max(level, qsub8(_levels[b], SPECTRUM_DECAY));
+    }
+}
+
+uint8_t Spectrum::GetLevel(byte band) {
+    return _levels[band];
+}
+
+uint8_t Spectrum::_levels[SPECTRUM_BANDS] = { 0 };
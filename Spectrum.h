@@ -0,0 +1,66 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// Number of frequency bands analyzed
+#define SPECTRUM_BANDS 6
+
+// Number of samples per analysis. With a 250 us period, the analysis lasts 16 ms, well within a 40 ms frame.
+#define SPECTRUM_SAMPLES 64
+
+// Time between two samples, in microseconds (4 kHz sampling, 62.5 Hz per bin)
+#define SPECTRUM_SAMPLE_PERIOD 250
+
+// How fast the levels fall back after a peak (per analysis, over 255)
+#define SPECTRUM_DECAY 12
+
+
+/**
+ * Audio spectrum analyzer
+ * Samples a microphone on an analog input and measures the energy of a few frequency bands
+ * with a fixed-point Goertzel filter bank. The filters are updated as the samples come,
+ * so no sample buffer is needed.
+ */
+class Spectrum {
+public:
+    /**
+     * Sample the input and update the band levels. Blocks for SPECTRUM_SAMPLES * SPECTRUM_SAMPLE_PERIOD.
+     * @param pin Analog input of the microphone
+     */
+    static void Analyze(byte pin);
+
+    /**
+     * @return The level of the given band, from 0 to 255
+     */
+    static uint8_t GetLevel(byte band);
+
+private:
+    /**
+     * Levels of every band, with a slow decay after the peaks
+     */
+    static uint8_t _levels[SPECTRUM_BANDS];
+};
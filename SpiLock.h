@@ -0,0 +1,55 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino_FreeRTOS.h>
+#include <semphr.h>
+
+
+/**
+ * Guards the SPI bus, shared by the Ethernet controller (Io task) and the SD card (Display task)
+ */
+class SpiLock {
+public:
+    /**
+     * Create the lock. Must be called before the tasks are started.
+     */
+    static void Init();
+
+    /**
+     * Wait for the bus to be free and take it
+     * @param ticks Maximum time to wait
+     * @return false if the bus is still busy after the given time
+     */
+    static bool Take(TickType_t ticks = portMAX_DELAY);
+
+    /**
+     * Release the bus
+     */
+    static void Give();
+
+private:
+    static SemaphoreHandle_t _mutex;
+};
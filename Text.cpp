@@ -0,0 +1,87 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+
+#include "Text.h"
+
+
+char* Text::Hex(char* out, byte value) {
+    *out++ = _hexChar(value >> 4);
+    *out++ = _hexChar(value & 0x0F);
+    *out = '\0';
+    return out;
+}
+
+char* Text::Decimal(char* out, unsigned long value) {
+    // The digits come out in reverse order
+    char digits[10];
+    byte count = 0;
+
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    while (count > 0)
+        *out++ = digits[--count];
+
+    *out = '\0';
+    return out;
+}
+
+char* Text::Copy_P(char* out, PGM_P text) {
+    while ((*out = pgm_read_byte(text++)) != '\0')
+        out++;
+
+    return out;
+}
+
+bool Text::ParseHex(const char* in, byte* value) {
+    // The second digit is only read if the first one is there: in can be at the end of the string
+    int8_t high = _hexDigit(in[0]);
+    if (high < 0)
+        return false;
+
+    int8_t low = _hexDigit(in[1]);
+    if (low < 0)
+        return false;
+
+    *value = (high << 4) | low;
+    return true;
+}
+
+char Text::_hexChar(byte digit) {
+    return digit < 10 ? '0' + digit : 'A' + digit - 10;
+}
+
+int8_t Text::_hexDigit(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
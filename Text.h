@@ -0,0 +1,68 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+
+/**
+ * Tiny text formatters and parsers, used instead of sprintf and strtol.
+ * The formatters write a null terminated string and return the position of the terminator,
+ * so that they can be chained.
+ */
+class Text {
+public:
+    /**
+     * Write a byte as two uppercase hexadecimal digits
+     */
+    static char* Hex(char* out, byte value);
+
+    /**
+     * Write a number in decimal
+     */
+    static char* Decimal(char* out, unsigned long value);
+
+    /**
+     * Copy a string stored in the program memory
+     */
+    static char* Copy_P(char* out, PGM_P text);
+
+    /**
+     * Parse two hexadecimal digits. Case insensitive.
+     * @return false if one of the characters is not a hexadecimal digit
+     */
+    static bool ParseHex(const char* in, byte* value);
+
+private:
+    /**
+     * @return the uppercase hexadecimal character of a digit between 0 and 15
+     */
+    static char _hexChar(byte digit);
+
+    /**
+     * @return the value of a hexadecimal digit, or -1 if it is not one
+     */
+    static int8_t _hexDigit(char c);
+};
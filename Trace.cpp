@@ -0,0 +1,146 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+
+#include "Text.h"
+#include "Trace.h"
+
+#define TRACE_IDLE 0
+#define TRACE_RECEIVED 1
+#define TRACE_APPLIED 2
+#define TRACE_FRAME 3
+#define TRACE_SHOW 4
+#define TRACE_SHOWN 5
+
+// A stage can be reached from several tasks: ShowStart also moves from applied to frame, and runs from
+// the Io task (e.g. off) or the Output task while the Display task runs FrameStart. Each check of the
+// stage and its update are done in a critical section, so a preempted task can't move it backwards.
+
+bool Trace::Begin(uint16_t id) {
+    bool started = false;
+
+    taskENTER_CRITICAL();
+    if (_stage == TRACE_IDLE) {
+        _id = id;
+        _received = micros();
+        _stage = TRACE_RECEIVED;
+        started = true;
+    }
+    taskEXIT_CRITICAL();
+
+    return started;
+}
+
+void Trace::Applied() {
+    taskENTER_CRITICAL();
+    if (_stage == TRACE_RECEIVED) {
+        _applied = micros();
+        _stage = TRACE_APPLIED;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void Trace::FrameStart() {
+    taskENTER_CRITICAL();
+    if (_stage == TRACE_APPLIED) {
+        _frame = micros();
+        _stage = TRACE_FRAME;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void Trace::ShowStart() {
+    taskENTER_CRITICAL();
+    // Some commands (e.g. off) show the leds right away, without any frame
+    if (_stage == TRACE_APPLIED) {
+        _frame = micros();
+        _stage = TRACE_FRAME;
+    }
+
+    if (_stage == TRACE_FRAME) {
+        _show = micros();
+        _stage = TRACE_SHOW;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void Trace::ShowEnd() {
+    taskENTER_CRITICAL();
+    if (_stage == TRACE_SHOW) {
+        _shown = micros();
+        _stage = TRACE_SHOWN;
+    }
+    taskEXIT_CRITICAL();
+}
+
+bool Trace::Report(char report[]) {
+    bool timedOut = false;
+
+    taskENTER_CRITICAL();
+    byte stage = _stage;
+    if (stage != TRACE_IDLE && stage != TRACE_SHOWN && micros() - _received >= TRACE_TIMEOUT * 1000UL) {
+        // Nothing have been shown, e.g. the color was already displayed
+        _stage = TRACE_IDLE;
+        timedOut = true;
+    }
+    taskEXIT_CRITICAL();
+
+    if (timedOut) {
+        Text::Copy_P(Text::Decimal(report, _id), PSTR(" timeout"));
+        return true;
+    }
+
+    if (stage != TRACE_SHOWN)
+        return false;
+
+    // Only Begin leaves this stage, from this task, so the timestamps can be read without the critical section
+    char* cursor = Text::Decimal(report, _id);
+    cursor = Text::Copy_P(cursor, PSTR(" apply="));
+    cursor = Text::Decimal(cursor, _applied - _received);
+    cursor = Text::Copy_P(cursor, PSTR(" wait="));
+    cursor = Text::Decimal(cursor, _frame - _applied);
+    cursor = Text::Copy_P(cursor, PSTR(" render="));
+    cursor = Text::Decimal(cursor, _show - _frame);
+    cursor = Text::Copy_P(cursor, PSTR(" show="));
+    Text::Decimal(cursor, _shown - _show);
+
+    _stage = TRACE_IDLE;
+    return true;
+}
+
+volatile byte Trace::_stage = TRACE_IDLE;
+
+volatile uint16_t Trace::_id = 0;
+
+volatile unsigned long Trace::_received = 0;
+
+volatile unsigned long Trace::_applied = 0;
+
+volatile unsigned long Trace::_frame = 0;
+
+volatile unsigned long Trace::_show = 0;
+
+volatile unsigned long Trace::_shown = 0;
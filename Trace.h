@@ -0,0 +1,99 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// Time after which an unfinished trace is reported anyway, in milliseconds
+#define TRACE_TIMEOUT 2000
+
+// Size of the longest report: "65535 apply=4294967295 wait=4294967295 render=4294967295 show=4294967295"
+#define TRACE_REPORT_SIZE 73
+
+
+/**
+ * Follows one command from its reception to the first frame showing it
+ * Only one command is traced at a time. The stages are timestamped with micros():
+ * - received: the Io task got the message or the button edge
+ * - applied: the Display method of the command returned
+ * - frame: the Display task started the first frame after the command
+ * - show: FastLED.show() started
+ * - shown: FastLED.show() returned
+ */
+class Trace {
+public:
+    /**
+     * Start tracing a command (Io task)
+     * @return false if another command is already being traced
+     */
+    static bool Begin(uint16_t id);
+
+    /**
+     * The command has been applied to the Display (Io task)
+     */
+    static void Applied();
+
+    /**
+     * A frame is starting (Display task)
+     */
+    static void FrameStart();
+
+    /**
+     * FastLED.show() is about to be called (any task)
+     */
+    static void ShowStart();
+
+    /**
+     * FastLED.show() returned (any task)
+     */
+    static void ShowEnd();
+
+    /**
+     * Write the report of the trace and make room for the next one, if it is complete or timed out (Io task)
+     * @param report Output string, at least TRACE_REPORT_SIZE characters long
+     * @return false if there is nothing to report yet
+     */
+    static bool Report(char report[]);
+
+private:
+    /**
+     * Last stage reached by the command
+     */
+    static volatile byte _stage;
+
+    /**
+     * Identifier of the command, given by the sender (0 for the buttons)
+     */
+    static volatile uint16_t _id;
+
+    /**
+     * Timestamps of every stage, in microseconds
+     */
+    static volatile unsigned long _received;
+    static volatile unsigned long _applied;
+    static volatile unsigned long _frame;
+    static volatile unsigned long _show;
+    static volatile unsigned long _shown;
+};
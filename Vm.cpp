@@ -0,0 +1,206 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <EEPROM.h>
+#define FASTLED_INTERNAL
+#include <FastLED.h>
+
+#include "Vm.h"
+
+// Arbitrary byte used to determine if a program have been written on the EEPROM
+#define VM_EEPROM_MAGIC_NUMBER 0b10100110
+
+// Number of values a program must leave on the stack (hue, saturation, value)
+#define VM_RESULT_SIZE 3
+
+
+bool Vm::Load(const byte* code, unsigned int length) {
+    if (!_validate(code, length))
+        return false;
+
+    // The program is loaded by the Io task while the Display task may be copying it
+    taskENTER_CRITICAL();
+    memcpy(_code, code, length);
+    _length = length;
+    taskEXIT_CRITICAL();
+
+    return true;
+}
+
+bool Vm::IsLoaded() {
+    return _length > 0;
+}
+
+void Vm::Save() {
+    int eepromCursor = VM_EEPROM_ADDRESS;
+
+    EEPROM.update(eepromCursor++, VM_EEPROM_MAGIC_NUMBER);
+    EEPROM.update(eepromCursor++, _length);
+
+    for (byte i = 0; i < _length; i++)
+        EEPROM.update(eepromCursor++, _code[i]);
+}
+
+void Vm::Restore() {
+    int eepromCursor = VM_EEPROM_ADDRESS;
+    byte code[VM_CODE_SIZE];
+
+    if (EEPROM.read(eepromCursor++) != VM_EEPROM_MAGIC_NUMBER)
+        return;
+
+    byte length = EEPROM.read(eepromCursor++);
+    if (length > VM_CODE_SIZE)
+        return;
+
+    for (byte i = 0; i < length; i++)
+        code[i] = EEPROM.read(eepromCursor++);
+
+    // The program is checked again, in case the EEPROM have been altered
+    Load(code, length);
+}
+
+void Vm::Render(CRGB* leds, uint16_t count, uint8_t hue) {
+    uint8_t stack[VM_STACK_SIZE];
+    byte code[VM_CODE_SIZE];
+    byte length;
+
+    // Work on a copy, so a new program can't be loaded in the middle of the frame
+    taskENTER_CRITICAL();
+    length = _length;
+    memcpy(code, _code, length);
+    taskEXIT_CRITICAL();
+
+    if (length == 0)
+        return;
+
+    const byte* end = code + length;
+
+    // Constant over the frame
+    unsigned long now = millis();
+    uint8_t time = now >> 4;
+
+    for (uint16_t i = 0; i < count; i++) {
+        // Points to the top of the stack
+        uint8_t* sp = stack - 1;
+
+        // The program has been validated, no bound checking is needed here
+        for (const byte* pc = code; pc < end; pc++) {
+            switch ((Op)*pc) {
+                case Op::Push:  *++sp = *++pc; break;
+                case Op::Index: *++sp = i; break;
+                case Op::Time:  *++sp = time; break;
+                case Op::Hue:   *++sp = hue; break;
+                case Op::Dup:   sp[1] = sp[0]; sp++; break;
+                case Op::Swap: {
+                    uint8_t tmp = sp[0];
+                    sp[0] = sp[-1];
+                    sp[-1] = tmp;
+                    break;
+                }
+                case Op::Drop:  sp--; break;
+                case Op::Add:   sp--; sp[0] = sp[0] + sp[1]; break;
+                case Op::Sub:   sp--; sp[0] = sp[0] - sp[1]; break;
+                case Op::Mul:   sp--; sp[0] = sp[0] * sp[1]; break;
+                case Op::Scale: sp--; sp[0] = scale8(sp[0], sp[1]); break;
+                case Op::QAdd:  sp--; sp[0] = qadd8(sp[0], sp[1]); break;
+                case Op::QSub:  sp--; sp[0] = qsub8(sp[0], sp[1]); break;
+                case Op::Sin:   sp[0] = sin8(sp[0]); break;
+                case Op::Cos:   sp[0] = cos8(sp[0]); break;
+                // Same as beat8(), without reading the clock for every pixel
+                case Op::Beat:  sp[0] = (now * sp[0] * 280) >> 16; break;
+                case Op::Blend: sp -= 2; sp[0] = lerp8by8(sp[0], sp[1], sp[2]); break;
+            }
+        }
+
+        leds[i] = CHSV(stack[0], stack[1], stack[2]);
+    }
+}
+
+bool Vm::_validate(const byte* code, unsigned int length) {
+    // Depth of the stack after each instruction
+    byte depth = 0;
+
+    if (length == 0 || length > VM_CODE_SIZE)
+        return false;
+
+    for (byte pc = 0; pc < length; pc++) {
+        // Number of values popped and pushed by the instruction
+        byte pop = 0, push = 1;
+
+        switch ((Op)code[pc]) {
+            case Op::Push:
+                // The operand must be part of the program
+                if (++pc >= length)
+                    return false;
+                break;
+            case Op::Index:
+            case Op::Time:
+            case Op::Hue:
+                break;
+            case Op::Dup:
+                pop = 1; push = 2;
+                break;
+            case Op::Swap:
+                pop = 2; push = 2;
+                break;
+            case Op::Drop:
+                pop = 1; push = 0;
+                break;
+            case Op::Add:
+            case Op::Sub:
+            case Op::Mul:
+            case Op::Scale:
+            case Op::QAdd:
+            case Op::QSub:
+                pop = 2;
+                break;
+            case Op::Sin:
+            case Op::Cos:
+            case Op::Beat:
+                pop = 1;
+                break;
+            case Op::Blend:
+                pop = 3;
+                break;
+            default:
+                return false;
+        }
+
+        if (depth < pop)
+            return false;
+
+        depth = depth - pop + push;
+
+        if (depth > VM_STACK_SIZE)
+            return false;
+    }
+
+    return depth == VM_RESULT_SIZE;
+}
+
+byte Vm::_code[VM_CODE_SIZE] = { 0 };
+
+byte Vm::_length = 0;
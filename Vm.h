@@ -0,0 +1,114 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#define FASTLED_INTERNAL
+#include <FastLED.h>
+
+// Maximum size of a program, in bytes
+#define VM_CODE_SIZE 32
+
+// Maximum depth of the stack
+#define VM_STACK_SIZE 8
+
+// Where the program is persisted. The display state is stored before it.
+#define VM_EEPROM_ADDRESS 32
+
+/**
+ * Instructions of the VM
+ * Every value is 8 bits and arithmetic wraps around, unless stated otherwise.
+ */
+enum class Op : byte {
+    Push = 0x01,  // Push the next byte of the program
+    Index = 0x02, // Push the index of the pixel
+    Time = 0x03,  // Push the time, in 16 ms steps
+    Hue = 0x04,   // Push the hue of the mode, changed by var
+    Dup = 0x05,   // Duplicate the top of the stack
+    Swap = 0x06,  // Swap the two values on top of the stack
+    Drop = 0x07,  // Remove the top of the stack
+    Add = 0x10,   // a b -> a + b
+    Sub = 0x11,   // a b -> a - b
+    Mul = 0x12,   // a b -> a * b
+    Scale = 0x13, // a b -> a * b / 256
+    QAdd = 0x14,  // a b -> a + b, saturated to 255
+    QSub = 0x15,  // a b -> a - b, saturated to 0
+    Sin = 0x20,   // a -> sin8(a)
+    Cos = 0x21,   // a -> cos8(a)
+    Beat = 0x22,  // bpm -> sawtooth wave at bpm beats per minute
+    Blend = 0x23  // a b f -> from a to b by f/256
+};
+
+
+/**
+ * Tiny stack-based virtual machine running user programs for the Program mode
+ * The program is evaluated once per pixel and must leave 3 values on the stack: hue, saturation and value.
+ */
+class Vm {
+public:
+    /**
+     * Check a program and make it the current one
+     * @return false if the program is invalid. The current program is then left untouched.
+     */
+    static bool Load(const byte* code, unsigned int length);
+
+    /**
+     * @return true if a valid program is loaded
+     */
+    static bool IsLoaded();
+
+    /**
+     * Save the current program to the EEPROM
+     */
+    static void Save();
+
+    /**
+     * Load the program saved on the EEPROM, if any
+     */
+    static void Restore();
+
+    /**
+     * Run the program on every pixel
+     * @param leds Pixels to draw
+     * @param count Number of pixels
+     * @param hue Value pushed by the Hue instruction
+     */
+    static void Render(CRGB* leds, uint16_t count, uint8_t hue);
+
+private:
+    /**
+     * Program currently loaded
+     */
+    static byte _code[VM_CODE_SIZE];
+
+    /**
+     * Length of the current program. 0 if there is none.
+     */
+    static byte _length;
+
+    /**
+     * Check every instruction is known and the stack never goes out of bounds
+     */
+    static bool _validate(const byte* code, unsigned int length);
+};
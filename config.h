@@ -30,6 +30,7 @@
  * - 1 Error and Warning
  * - 2 Info
  * - 3 Debug
+ * The logs are sent as binary records, read them with tools/log_decode.py
  */
 #define LOG 0
 
@@ -42,6 +43,27 @@
 #define LEDS_NUMBER 90
 #define LEDS_PIN 6
 #define LEDS_DELAY 40 // in milliseconds (40ms gives 25 fps)
+#define LEDS_KEYFRAMES 0 // Fire and Aurora are fully computed every LEDS_KEYFRAMES frames only, and blended in between (see tools/host/keyframe_bench.cpp). 0 computes every frame.
+#define LEDS_DOUBLE_BUFFER 0 // 1 renders the next frame while the current one is sent to the leds (see tools/host/pipeline_check.cpp). Only faster when the leds are driven without the CPU (DMA).
+
+#define LEDS_MATRIX 0 // 1 if the leds are arranged as a matrix. Fire and Aurora are then drawn in 2D.
+#define LEDS_MATRIX_WIDTH 16 // Number of leds per row, as wired. LEDS_NUMBER must be LEDS_MATRIX_WIDTH * LEDS_MATRIX_HEIGHT.
+#define LEDS_MATRIX_HEIGHT 16 // Number of rows, as wired
+#define LEDS_MATRIX_SERPENTINE 1 // 1 if every other row is wired backwards. 0 if all the rows go the same way.
+#define LEDS_MATRIX_ROTATION 0 // How the matrix is hung, in degrees counterclockwise from the wiring layout: 0, 90, 180 or 270
+#define LEDS_MATRIX_MIRROR_X 0 // 1 flips the picture horizontally
+#define LEDS_MATRIX_MIRROR_Y 0 // 1 flips the picture vertically
+
+#define LEDS_SERIAL_STREAMING 0 // 1 lets a computer drive the strip through USB using the Adalight protocol. 0 disables it to save memory space.
+#define LEDS_SERIAL_BAUD 500000 // Baud rate of the serial port when streaming is enabled (must match the computer's software)
+#define LEDS_SERIAL_TIMEOUT 3000 // in milliseconds. Without any frame during this time, the saved mode is restored.
+
+#define LEDS_AUDIO 0 // 1 adds the Audio mode, reacting to a microphone module. 0 disables it to save memory space.
+#define LEDS_AUDIO_PIN 0 // Analog input of the microphone module
+
+#define LEDS_CLIP 0 // 1 adds the Clip mode, playing animations from the SD card of the Ethernet shield. 0 disables it to save memory space.
+
+#define LEDS_PROGRAM 0 // 1 adds the Program mode, running effects uploaded through MQTT. 0 disables it to save memory space.
 
 
 // ----------------
@@ -55,3 +77,7 @@
 #define IO_NETWORKING 1 // 1 activates ethernet connection. 0 disables it to save memory space.
 #define IO_MAC_ADDRESS { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF } // Mac address of the device (should be written on your ethernet board)
 #define IO_BROKER_ADDRESS "192.168.0.1" // Address of the MQTT broker (e.g. "192.168.0.1").
+#define IO_LEASE_CACHE 1 // 1 reuses the last DHCP lease at boot and only asks the DHCP server again if it fails.
+#define IO_STATS 0 // 1 counts the messages received and publishes the counters on request (see tools/mqtt_load.py and tools/host/io_load.cpp).
+#define IO_TRACE 0 // 1 measures the latency of the commands and publishes it (see tools/trace_latency.py).
+#define IO_GROUPS 0 // 1 adds a topic per device and per group, and lets the commands target some groups only.
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""
+Encoder for the AtmoLight animation clips (see ClipReader.h)
+
+Takes raw RGB frames (3 bytes per led, one frame after the other) and writes a
+clip to copy on the SD card as CLIP0.ALC to CLIP9.ALC. The first frame is a
+keyframe, the others only store the differences with the previous frame.
+
+Any video can be turned into raw frames with ffmpeg, scaled to one row of leds:
+
+    ffmpeg -i fire.mp4 -vf scale=90:1,fps=25 -f rawvideo -pix_fmt rgb24 fire.rgb
+
+Usage:
+    clip_encode.py --leds 90 --period 40 fire.rgb CLIP0.ALC
+
+Once written, the clip is decoded again and compared to the input, then the
+average size of a frame and the read throughput needed on the SD card are given.
+"""
+
+import argparse
+import struct
+import sys
+
+VERSION = 1
+HEADER = struct.Struct("<3sBHHH")
+
+SKIP = 0x00
+RUN = 0x40
+LITERAL = 0x80
+MAX_LENGTH = 64
+
+
+def encode_frame(frame, previous):
+    """frame and previous are lists of (r, g, b). previous is None for the keyframe."""
+    out = bytearray()
+    count = len(frame)
+    i = 0
+
+    def unchanged(j):
+        return previous is not None and frame[j] == previous[j]
+
+    while i < count:
+        end = i
+
+        if unchanged(i):
+            while end < count and end - i < MAX_LENGTH and unchanged(end):
+                end += 1
+            out.append(SKIP | (end - i - 1))
+            i = end
+            continue
+
+        while end < count and end - i < MAX_LENGTH and frame[end] == frame[i]:
+            end += 1
+        if end - i >= 2:
+            out.append(RUN | (end - i - 1))
+            out += bytes(frame[i])
+            i = end
+            continue
+
+        # Literal colors, until a skip or a run can take over
+        end = i + 1
+        while end < count and end - i < MAX_LENGTH and not unchanged(end) \
+                and not (end + 1 < count and frame[end] == frame[end + 1]):
+            end += 1
+        out.append(LITERAL | (end - i - 1))
+        for color in frame[i:end]:
+            out += bytes(color)
+        i = end
+
+    return bytes(out)
+
+
+def decode(data):
+    """Same logic as ClipReader::ReadFrame, used to check the clip"""
+    magic, version, leds, period, count = HEADER.unpack_from(data)
+    if magic != b"ALC" or version != VERSION:
+        raise ValueError("not a clip")
+
+    position = HEADER.size
+    frame = [(0, 0, 0)] * leds
+    frames = []
+
+    for _ in range(count):
+        frame = list(frame)
+        led = 0
+        while led < leds:
+            op = data[position]
+            position += 1
+            length = (op & 0x3F) + 1
+            kind = op & 0xC0
+            if kind == RUN:
+                color = tuple(data[position:position + 3])
+                position += 3
+                for i in range(led, min(led + length, leds)):
+                    frame[i] = color
+            elif kind == LITERAL:
+                for i in range(led, led + length):
+                    if i < leds:
+                        frame[i] = tuple(data[position:position + 3])
+                    position += 3
+            elif kind != SKIP:
+                raise ValueError("unknown operation 0x%02x" % op)
+            led += length
+        frames.append(frame)
+
+    return period, frames
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Encoder for the AtmoLight animation clips")
+    parser.add_argument("input", help="raw RGB frames")
+    parser.add_argument("output", help="clip to write (e.g. CLIP0.ALC)")
+    parser.add_argument("--leds", type=int, required=True, help="number of leds per frame")
+    parser.add_argument("--period", type=int, default=40, help="time between two frames, in milliseconds")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as source:
+        raw = source.read()
+
+    frame_size = args.leds * 3
+    if len(raw) == 0 or len(raw) % frame_size != 0:
+        sys.exit("%s: the size must be a multiple of %d bytes (%d leds)" % (args.input, frame_size, args.leds))
+
+    frames = []
+    for offset in range(0, len(raw), frame_size):
+        chunk = raw[offset:offset + frame_size]
+        frames.append([tuple(chunk[i:i + 3]) for i in range(0, frame_size, 3)])
+
+    if len(frames) > 0xFFFF:
+        sys.exit("too many frames (%d, max 65535)" % len(frames))
+
+    clip = bytearray(HEADER.pack(b"ALC", VERSION, args.leds, args.period, len(frames)))
+    previous = None
+    for frame in frames:
+        clip += encode_frame(frame, previous)
+        previous = frame
+
+    with open(args.output, "wb") as output:
+        output.write(clip)
+
+    period, decoded = decode(bytes(clip))
+    if decoded != frames:
+        sys.exit("error: the clip does not decode back to the input")
+
+    average = (len(clip) - HEADER.size) / len(frames)
+    print("%d frames, %d bytes (%.1f%% of the raw frames)" % (len(frames), len(clip), 100.0 * len(clip) / len(raw)))
+    print("%.1f bytes per frame on average, %.1f kB/s to read at %.1f fps" % (
+        average, average * 1000 / period / 1024, 1000.0 / period))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""
+Fan-out benchmark for the AtmoLight group addressing
+
+Simulates a fleet of devices built with IO_GROUPS set to 1 (config.h): every node
+subscribes to lights/all, to its own topic and to the topics of its groups, and
+ignores the commands whose group mask ("@xx") does not match. Then it targets one
+group of the fleet in three ways and compares them:
+
+    device   one publish per member, on lights/<mac>
+    group    one publish on lights/group/<n>
+    mask     one publish on lights/all, with the mask of the group
+
+For each way, prints the publishes sent, the messages the broker delivered (all
+the nodes count what they receive, even the filtered commands) and the fan-out
+latency: from the first publish to the last member reached.
+
+Usage:
+    fanout_bench.py --host 127.0.0.1 --nodes 50 --rounds 100
+
+Requires paho-mqtt (pip install paho-mqtt).
+"""
+
+import argparse
+import random
+import string
+import threading
+import time
+
+import paho.mqtt.client as paho
+
+T_ALL = "lights/all"
+T_DEVICE = "lights/%s"
+T_GROUP = "lights/group/%d"
+
+GROUPS_NUMBER = 8
+
+
+def new_client():
+    # paho-mqtt 2 asks for the callback API version
+    if hasattr(paho, "CallbackAPIVersion"):
+        return paho.Client(paho.CallbackAPIVersion.VERSION1)
+    return paho.Client()
+
+
+class Node:
+    """A simulated device, with the same topics and filtering as Io.cpp"""
+
+    def __init__(self, number, groups, bench):
+        self.mac = "DEADBE%06X" % number
+        self.groups = groups
+        self.bench = bench
+        self.received = 0
+        self.connected = threading.Event()
+        self.client = new_client()
+        self.client.on_connect = self.on_connect
+        self.client.on_message = self.on_message
+
+    def start(self, host, port):
+        self.client.connect(host, port)
+        self.client.loop_start()
+
+    def stop(self):
+        self.client.loop_stop()
+        self.client.disconnect()
+
+    def on_connect(self, client, userdata, flags, rc):
+        topics = [T_ALL, T_DEVICE % self.mac]
+        topics += [T_GROUP % group for group in range(GROUPS_NUMBER) if self.groups & (1 << group)]
+        client.subscribe([(topic, 0) for topic in topics])
+        self.connected.set()
+
+    def on_message(self, client, userdata, message):
+        now = time.monotonic()
+        self.received += 1
+
+        # "#xxxxxx <round> @xx", the same options as the device
+        _, *options = message.payload.decode().split(" ")
+        sequence = None
+        for option in options:
+            # Like the device, a mask that can't be read matches no group
+            if option.startswith("@"):
+                mask = option[1:]
+                if len(mask) != 2 or any(c not in string.hexdigits for c in mask) or int(mask, 16) & self.groups == 0:
+                    return
+            if option.isdigit():
+                sequence = int(option)
+
+        if sequence is not None:
+            self.bench.reached(sequence, self, now)
+
+
+class Bench:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.arrivals = {}
+
+    def reached(self, sequence, node, now):
+        with self.lock:
+            self.arrivals.setdefault(sequence, {})[node.mac] = now
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Fan-out benchmark for the AtmoLight group addressing")
+    parser.add_argument("--host", default="127.0.0.1", help="address of the broker")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--nodes", type=int, default=50, help="number of simulated devices")
+    parser.add_argument("--rounds", type=int, default=100, help="commands sent with each way")
+    parser.add_argument("--group", type=int, default=0, help="group targeted")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    bench = Bench()
+
+    # Every node is member of one or two random groups
+    nodes = []
+    for number in range(args.nodes):
+        groups = 0
+        for group in random.sample(range(GROUPS_NUMBER), random.randint(1, 2)):
+            groups |= 1 << group
+        nodes.append(Node(number, groups, bench))
+
+    for node in nodes:
+        node.start(args.host, args.port)
+    for node in nodes:
+        if not node.connected.wait(10):
+            raise SystemExit("A node could not connect to the broker")
+
+    members = [node for node in nodes if node.groups & (1 << args.group)]
+    if not members:
+        raise SystemExit("No node is member of the group %d, try another --seed" % args.group)
+    print("%d nodes, %d members of the group %d\n" % (len(nodes), len(members), args.group))
+
+    controller = new_client()
+    controller.connect(args.host, args.port)
+    controller.loop_start()
+    time.sleep(1)
+
+    ways = {
+        "device": lambda payload: [(T_DEVICE % node.mac, payload) for node in members],
+        "group": lambda payload: [(T_GROUP % args.group, payload)],
+        "mask": lambda payload: [(T_ALL, "%s @%02x" % (payload, 1 << args.group))],
+    }
+
+    print("%-8s %10s %10s %8s %8s %8s %8s" % ("way", "publishes", "delivered", "missed", "p50 ms", "p90 ms", "p99 ms"))
+    sequence = 0
+    for name, messages in ways.items():
+        received_before = sum(node.received for node in nodes)
+        publishes = 0
+        latencies = []
+        missed = 0
+
+        for _ in range(args.rounds):
+            sequence += 1
+            payload = "#%06x %d" % (random.getrandbits(24), sequence)
+
+            start = time.monotonic()
+            for topic, message in messages(payload):
+                controller.publish(topic, message)
+                publishes += 1
+
+            # Wait for every member, or give up after one second
+            deadline = start + 1
+            while time.monotonic() < deadline:
+                with bench.lock:
+                    arrivals = bench.arrivals.get(sequence, {})
+                    if len(arrivals) >= len(members):
+                        break
+                time.sleep(0.001)
+
+            with bench.lock:
+                arrivals = bench.arrivals.pop(sequence, {})
+            missed += len(members) - len(arrivals)
+            if arrivals:
+                latencies.append((max(arrivals.values()) - start) * 1000)
+
+        # Let the last deliveries come in before counting them
+        time.sleep(0.5)
+        delivered = sum(node.received for node in nodes) - received_before
+
+        print("%-8s %10d %10d %8d %8.1f %8.1f %8.1f" % (
+            name, publishes, delivered, missed,
+            percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99)))
+
+    controller.loop_stop()
+    for node in nodes:
+        node.stop()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,123 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Just enough of the Arduino core to build the sketch modules on a PC (see build.sh)
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcpy_P strcpy
+#define memcpy_P memcpy
+
+inline size_t strlcpy_P(char* destination, const char* source, size_t size) {
+    size_t length = strlen(source);
+    if (size > 0) {
+        size_t copied = length < size - 1 ? length : size - 1;
+        memcpy(destination, source, copied);
+        destination[copied] = '\0';
+    }
+    return length;
+}
+
+// Like the Arduino macros, accepts two different types
+template<class A, class B> inline auto min(A a, B b) -> decltype(a + b) { return a < b ? a : b; }
+template<class A, class B> inline auto max(A a, B b) -> decltype(a + b) { return a > b ? a : b; }
+
+/**
+ * Added to the clock, so the checks can move the time forward (in microseconds)
+ */
+inline unsigned long& timeShift() {
+    static unsigned long shift = 0;
+    return shift;
+}
+
+/**
+ * When stopped, the clock only moves with timeShift(), so the checks can give the time of every frame
+ */
+inline bool& clockStopped() {
+    static bool stopped = false;
+    return stopped;
+}
+
+inline unsigned long micros() {
+    if (clockStopped())
+        return timeShift();
+
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000UL + now.tv_nsec / 1000 + timeShift();
+}
+
+inline unsigned long millis() {
+    return micros() / 1000;
+}
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+/**
+ * Digital pins keep the last level written, and read LOW until then (e.g. buttons released)
+ */
+inline uint8_t& pinLevel(uint8_t pin) {
+    static uint8_t levels[64] = {};
+    return levels[pin];
+}
+
+inline void pinMode(uint8_t, uint8_t) {}
+
+inline void digitalWrite(uint8_t pin, uint8_t level) {
+    pinLevel(pin) = level;
+}
+
+inline int digitalRead(uint8_t pin) {
+    return pinLevel(pin);
+}
+
+/**
+ * Analog inputs are provided by the program using the module (e.g. samples read from a file)
+ */
+int analogRead(uint8_t pin);
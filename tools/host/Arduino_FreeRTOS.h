@@ -0,0 +1,62 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * FreeRTOS stand-in: the host programs drive the tasks themselves, one step at a time, or run them on threads
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <unistd.h>
+
+#include <mutex>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY ((TickType_t)-1)
+
+#define portTICK_PERIOD_MS 1
+
+inline void vTaskDelay(TickType_t ticks) {
+    usleep(ticks * portTICK_PERIOD_MS * 1000UL);
+}
+
+inline void taskYIELD() {}
+
+/**
+ * The critical sections of all the tasks are mutually exclusive, like with the interrupts disabled
+ */
+inline std::recursive_mutex& criticalSection() {
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+#define taskENTER_CRITICAL() criticalSection().lock()
+#define taskEXIT_CRITICAL() criticalSection().unlock()
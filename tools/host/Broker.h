@@ -0,0 +1,280 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * MQTT broker for the host programs, on the loopback interface: any number of clients, QoS 0 only,
+ * exact topics only (no wildcards). The publishers get their own messages back, like with mosquitto.
+ */
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <list>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Broker {
+public:
+    /**
+     * Listen on a free port, and serve the clients on a thread
+     * @param queueLimit Most messages waiting for a client that doesn't read them fast enough, the next ones
+     * are dropped. 0 for no limit.
+     */
+    Broker(size_t queueLimit = 0) : _queueLimit(queueLimit) {
+        _listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t size = sizeof(address);
+        bind(_listener, (sockaddr*)&address, size);
+        listen(_listener, 64);
+        getsockname(_listener, (sockaddr*)&address, &size);
+        _port = ntohs(address.sin_port);
+
+        _thread = std::thread(&Broker::_run, this);
+    }
+
+    ~Broker() {
+        stop();
+    }
+
+    uint16_t port() const { return _port; }
+
+    /**
+     * Close every connection
+     */
+    void stop() {
+        if (!_thread.joinable())
+            return;
+
+        _stopping = true;
+        _thread.join();
+        for (Session& session : _sessions)
+            close(session.socket);
+        close(_listener);
+    }
+
+    std::atomic<unsigned long> published{0}; // Messages received from the clients
+    std::atomic<unsigned long> delivered{0}; // Messages sent to the subscribers
+    std::atomic<unsigned long> dropped{0}; // Messages not sent, the queue of the subscriber being full
+    std::atomic<unsigned long> queued{0}; // Messages waiting to be sent
+
+    /**
+     * Called on the thread of the broker with every message published, before it is sent to the subscribers
+     */
+    std::function<void(const std::string& topic, const std::string& payload)> onPublish;
+
+private:
+    struct Packet {
+        std::vector<uint8_t> bytes;
+        bool message;
+    };
+
+    struct Session {
+        int socket;
+        std::vector<uint8_t> input;
+        std::deque<Packet> output;
+        size_t sent; // Bytes of the first packet of the output already sent
+        size_t messages; // Messages in the output
+        std::vector<std::string> topics;
+    };
+
+    void _run() {
+        while (!_stopping) {
+            std::vector<pollfd> polled(1, pollfd{ _listener, POLLIN, 0 });
+            for (Session& session : _sessions)
+                polled.push_back(pollfd{ session.socket, (short)(POLLIN | (session.output.empty() ? 0 : POLLOUT)), 0 });
+
+            if (poll(polled.data(), polled.size(), 10) <= 0)
+                continue;
+
+            if (polled[0].revents & POLLIN)
+                _sessions.push_back(Session{ accept(_listener, NULL, NULL), {}, {}, 0, 0, {} });
+
+            auto session = _sessions.begin();
+            for (size_t i = 1; i < polled.size(); i++) {
+                bool open = true;
+                if (polled[i].revents & (POLLIN | POLLHUP | POLLERR))
+                    open = _receive(*session);
+                if (open && (polled[i].revents & POLLOUT))
+                    _flush(*session);
+
+                if (open) {
+                    session++;
+                }
+                else {
+                    queued -= session->messages;
+                    close(session->socket);
+                    session = _sessions.erase(session);
+                }
+            }
+        }
+    }
+
+    /**
+     * Read what the client sent, and handle its complete packets
+     * @return false if the connection is closed
+     */
+    bool _receive(Session& session) {
+        uint8_t buffer[4096];
+        ssize_t length = recv(session.socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (length <= 0)
+            return length < 0 && errno == EAGAIN;
+        session.input.insert(session.input.end(), buffer, buffer + length);
+
+        for (;;) {
+            // Fixed header: type, then the remaining length on up to 4 bytes
+            size_t header = 1;
+            uint32_t remaining = 0, multiplier = 1;
+            do {
+                if (header >= session.input.size())
+                    return true;
+                remaining += (session.input[header] & 0x7F) * multiplier;
+                multiplier <<= 7;
+            } while (session.input[header++] & 0x80);
+
+            if (session.input.size() < header + remaining)
+                return true;
+
+            std::vector<uint8_t> packet(session.input.begin(), session.input.begin() + header + remaining);
+            session.input.erase(session.input.begin(), session.input.begin() + header + remaining);
+            if (!_handle(session, packet, header))
+                return false;
+        }
+    }
+
+    /**
+     * @return false if the client disconnected
+     */
+    bool _handle(Session& session, const std::vector<uint8_t>& packet, size_t header) {
+        const uint8_t* body = packet.data() + header;
+        size_t length = packet.size() - header;
+
+        switch (packet[0] & 0xF0) {
+            case 0x10: // CONNECT
+                _send(session, { 0x20, 2, 0, 0 }, false);
+                break;
+
+            case 0x80: // SUBSCRIBE
+            case 0xA0: { // UNSUBSCRIBE
+                bool subscribe = (packet[0] & 0xF0) == 0x80;
+                std::vector<uint8_t> ack = { (uint8_t)(subscribe ? 0x90 : 0xB0), 2, body[0], body[1] };
+                for (size_t i = 2; i + 2 <= length;) {
+                    std::string topic((const char*)&body[i + 2], body[i] << 8 | body[i + 1]);
+                    i += 2 + topic.size();
+                    if (subscribe) {
+                        if (std::find(session.topics.begin(), session.topics.end(), topic) == session.topics.end())
+                            session.topics.push_back(topic);
+                        ack.push_back(0); // Granted QoS
+                        ack[1]++;
+                        i++;
+                    }
+                    else {
+                        session.topics.erase(std::remove(session.topics.begin(), session.topics.end(), topic), session.topics.end());
+                    }
+                }
+                _send(session, ack, false);
+                break;
+            }
+
+            case 0x30: { // PUBLISH
+                published++;
+                std::string topic((const char*)&body[2], body[0] << 8 | body[1]);
+                if (onPublish)
+                    onPublish(topic, std::string((const char*)&body[2 + topic.size()], length - 2 - topic.size()));
+
+                for (Session& subscriber : _sessions) {
+                    if (std::find(subscriber.topics.begin(), subscriber.topics.end(), topic) != subscriber.topics.end())
+                        _send(subscriber, packet, true);
+                }
+                break;
+            }
+
+            case 0xC0: // PINGREQ
+                _send(session, { 0xD0, 0 }, false);
+                break;
+
+            case 0xE0: // DISCONNECT
+                return false;
+        }
+
+        return true;
+    }
+
+    void _send(Session& session, const std::vector<uint8_t>& bytes, bool message) {
+        if (message && _queueLimit > 0 && session.messages >= _queueLimit) {
+            dropped++;
+            return;
+        }
+
+        session.output.push_back(Packet{ bytes, message });
+        if (message) {
+            session.messages++;
+            queued++;
+        }
+        _flush(session);
+    }
+
+    /**
+     * Send as much of the output as the socket takes
+     */
+    void _flush(Session& session) {
+        while (!session.output.empty()) {
+            Packet& packet = session.output.front();
+            ssize_t length = send(session.socket, packet.bytes.data() + session.sent, packet.bytes.size() - session.sent,
+                MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (length <= 0)
+                return;
+
+            session.sent += length;
+            if (session.sent < packet.bytes.size())
+                return;
+
+            if (packet.message) {
+                session.messages--;
+                queued--;
+                delivered++;
+            }
+            session.output.pop_front();
+            session.sent = 0;
+        }
+    }
+
+    size_t _queueLimit;
+    int _listener;
+    uint16_t _port;
+    std::list<Session> _sessions;
+    std::thread _thread;
+    std::atomic<bool> _stopping{false};
+};
@@ -0,0 +1,173 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Ethernet library stand-in: the interface is up at once, and the clients are TCP sockets of the host
+ */
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <Client.h>
+
+// Receive buffer of a socket of the W5100, with its 8 KB shared by 4 sockets
+#define ETHERNET_SOCKET_BUFFER 2048
+
+class EthernetClass {
+public:
+    /**
+     * Configure the interface with DHCP: an address made of the end of the MAC address, unless dhcp is false
+     * @return 1 if the interface is configured, 0 if the DHCP server didn't answer
+     */
+    int begin(uint8_t* mac, unsigned long timeout = 60000) {
+        if (!dhcp)
+            return 0;
+
+        begin(mac, IPAddress(10, 0, mac[4], mac[5]), IPAddress(10, 0, 0, 1), IPAddress(10, 0, 0, 1), IPAddress(255, 255, 0, 0));
+        return 1;
+    }
+
+    void begin(uint8_t* mac, IPAddress ip, IPAddress dns, IPAddress gateway, IPAddress subnet) {
+        _ip = ip;
+        _dns = dns;
+        _gateway = gateway;
+        _subnet = subnet;
+    }
+
+    int maintain() { return 0; }
+
+    IPAddress localIP() { return _ip; }
+    IPAddress gatewayIP() { return _gateway; }
+    IPAddress dnsServerIP() { return _dns; }
+    IPAddress subnetMask() { return _subnet; }
+
+    bool dhcp = true;
+
+    /**
+     * When set, the clients connect to this port of the loopback interface, whatever the address they are
+     * given (e.g. the broker configured in config.h)
+     */
+    uint16_t brokerPort = 0;
+
+private:
+    IPAddress _ip;
+    IPAddress _dns;
+    IPAddress _gateway;
+    IPAddress _subnet;
+};
+
+static EthernetClass Ethernet;
+
+/**
+ * Client over a TCP socket, counting the writes: on the Ethernet shield each write is one SEND command
+ * of the W5100
+ */
+class EthernetClient : public Client {
+public:
+    int connect(IPAddress ip, uint16_t port) override {
+        char host[16];
+        snprintf(host, sizeof(host), "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+        return connect(host, port);
+    }
+
+    int connect(const char* host, uint16_t port) override {
+        in_addr remote;
+        _remote = inet_pton(AF_INET, host, &remote) == 1 ? IPAddress((const uint8_t*)&remote.s_addr) : IPAddress();
+
+        if (Ethernet.brokerPort != 0) {
+            host = "127.0.0.1";
+            port = Ethernet.brokerPort;
+        }
+
+        addrinfo* address;
+        if (getaddrinfo(host, std::to_string(port).c_str(), NULL, &address) != 0)
+            return 0;
+
+        stop();
+        _socket = socket(address->ai_family, SOCK_STREAM, 0);
+
+        // Like the W5100, send every write at once, and only hold a few packets
+        int one = 1, size = ETHERNET_SOCKET_BUFFER;
+        setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(_socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+        int opened = ::connect(_socket, address->ai_addr, address->ai_addrlen) == 0;
+        freeaddrinfo(address);
+        return opened;
+    }
+
+    size_t write(uint8_t value) override {
+        return write(&value, 1);
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        writes++;
+        return send(_socket, buffer, size, MSG_NOSIGNAL);
+    }
+
+    int available() override {
+        int count = 0;
+        ioctl(_socket, FIONREAD, &count);
+        return count;
+    }
+
+    int read() override {
+        uint8_t value;
+        return recv(_socket, &value, 1, 0) == 1 ? value : -1;
+    }
+
+    void stop() override {
+        if (_socket >= 0)
+            close(_socket);
+        _socket = -1;
+    }
+
+    uint8_t connected() override {
+        if (_socket < 0)
+            return 0;
+
+        uint8_t value;
+        int peeked = recv(_socket, &value, 1, MSG_PEEK | MSG_DONTWAIT);
+        return peeked > 0 || (peeked < 0 && errno == EAGAIN);
+    }
+
+    IPAddress remoteIP() { return _remote; }
+
+    unsigned long writes = 0;
+
+private:
+    int _socket = -1;
+    IPAddress _remote;
+};
@@ -0,0 +1,324 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * The parts of FastLED 3.x used by the sketch, ported as they are (FASTLED_SCALE8_FIXED = 1),
+ * so the host checks give the same colors as the boards
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <unistd.h>
+
+typedef uint8_t fract8;
+
+inline uint8_t scale8(uint8_t i, fract8 scale) {
+    return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+inline uint8_t scale8_video(uint8_t i, fract8 scale) {
+    return (((int)i * (int)scale) >> 8) + ((i && scale) ? 1 : 0);
+}
+
+inline uint8_t dim8_video(uint8_t x) {
+    return scale8_video(x, x);
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) {
+    unsigned int t = i + j;
+    return t > 255 ? 255 : t;
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j) {
+    int t = i - j;
+    return t < 0 ? 0 : t;
+}
+
+inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB) {
+    uint16_t partial = (a << 8) | b;
+    partial += b * amountOfB;
+    partial -= a * amountOfB;
+    return partial >> 8;
+}
+
+inline uint8_t lerp8by8(uint8_t a, uint8_t b, fract8 frac) {
+    if (b > a)
+        return a + scale8(b - a, frac);
+    return a - scale8(a - b, frac);
+}
+
+inline uint8_t sin8(uint8_t theta) {
+    static const uint8_t b_m16_interleave[] = { 0, 49, 49, 41, 90, 27, 117, 10 };
+
+    uint8_t offset = theta;
+    if (theta & 0x40)
+        offset = (uint8_t)255 - offset;
+    offset &= 0x3F;
+
+    uint8_t secoffset = offset & 0x0F;
+    if (theta & 0x40)
+        secoffset++;
+
+    uint8_t section = offset >> 4;
+    uint8_t b = b_m16_interleave[section * 2];
+    uint8_t m16 = b_m16_interleave[section * 2 + 1];
+    uint8_t mx = (m16 * secoffset) >> 4;
+
+    int8_t y = mx + b;
+    if (theta & 0x80)
+        y = -y;
+    y += 128;
+    return y;
+}
+
+inline uint8_t cos8(uint8_t theta) {
+    return sin8(theta + 64);
+}
+
+inline uint16_t& random16Seed() {
+    static uint16_t seed = 1337;
+    return seed;
+}
+
+inline void random16_set_seed(uint16_t seed) {
+    random16Seed() = seed;
+}
+
+inline uint8_t random8() {
+    random16Seed() = random16Seed() * 2053 + 13849;
+    return (uint8_t)(random16Seed() + (random16Seed() >> 8));
+}
+
+inline uint8_t sqrt16(uint16_t x) {
+    if (x <= 1)
+        return x;
+
+    uint16_t low = 1;
+    uint16_t high = x > 7904 ? 255 : (x >> 5) + 8;
+    do {
+        uint16_t mid = (low + high) >> 1;
+        if ((uint32_t)mid * mid > x)
+            high = mid - 1;
+        else
+            low = mid + 1;
+    } while (high >= low);
+    return low - 1;
+}
+
+struct CHSV {
+    uint8_t hue;
+    uint8_t sat;
+    uint8_t val;
+
+    CHSV() : hue(0), sat(0), val(0) {}
+    CHSV(uint8_t h, uint8_t s, uint8_t v) : hue(h), sat(s), val(v) {}
+};
+
+struct CRGB;
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb);
+
+/**
+ * Number of HSV to RGB conversions since the start, counted for the benchmarks
+ */
+inline unsigned long& hsvConversions() {
+    static unsigned long count = 0;
+    return count;
+}
+
+struct CRGB {
+    union {
+        struct {
+            uint8_t r;
+            uint8_t g;
+            uint8_t b;
+        };
+        uint8_t raw[3];
+    };
+
+    CRGB() : r(0), g(0), b(0) {}
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+    CRGB(uint32_t code) : r(code >> 16), g(code >> 8), b(code) {}
+    CRGB(const CHSV& hsv) { hsv2rgb_rainbow(hsv, *this); }
+
+    CRGB& operator=(const CHSV& hsv) {
+        hsv2rgb_rainbow(hsv, *this);
+        return *this;
+    }
+
+    uint8_t& operator[](uint8_t x) { return raw[x]; }
+
+    CRGB& nscale8_video(uint8_t scale) {
+        uint8_t nonzeroscale = (scale != 0) ? 1 : 0;
+        r = (r == 0) ? 0 : (((int)r * (int)scale) >> 8) + nonzeroscale;
+        g = (g == 0) ? 0 : (((int)g * (int)scale) >> 8) + nonzeroscale;
+        b = (b == 0) ? 0 : (((int)b * (int)scale) >> 8) + nonzeroscale;
+        return *this;
+    }
+
+    CRGB& operator+=(const CRGB& rhs) {
+        r = qadd8(r, rhs.r);
+        g = qadd8(g, rhs.g);
+        b = qadd8(b, rhs.b);
+        return *this;
+    }
+
+    bool operator==(const CRGB& rhs) const { return r == rhs.r && g == rhs.g && b == rhs.b; }
+    bool operator!=(const CRGB& rhs) const { return !(*this == rhs); }
+
+    enum { Black = 0x000000 };
+};
+
+inline CRGB operator+(const CRGB& p1, const CRGB& p2) {
+    return CRGB(qadd8(p1.r, p2.r), qadd8(p1.g, p2.g), qadd8(p1.b, p2.b));
+}
+
+inline CRGB operator&(const CRGB& p1, const CRGB& p2) {
+    return CRGB(min(p1.r, p2.r), min(p1.g, p2.g), min(p1.b, p2.b));
+}
+
+inline CRGB blend(const CRGB& p1, const CRGB& p2, fract8 amountOfP2) {
+    return CRGB(blend8(p1.r, p2.r, amountOfP2), blend8(p1.g, p2.g, amountOfP2), blend8(p1.b, p2.b, amountOfP2));
+}
+
+inline void fill_solid(CRGB* leds, int count, const CRGB& color) {
+    for (int i = 0; i < count; i++)
+        leds[i] = color;
+}
+
+inline void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb) {
+    hsvConversions()++;
+
+    const uint8_t K255 = 255, K171 = 171, K170 = 170, K85 = 85;
+
+    uint8_t hue = hsv.hue;
+    uint8_t sat = hsv.sat;
+    uint8_t val = hsv.val;
+
+    uint8_t offset8 = (hue & 0x1F) << 3;
+    uint8_t third = scale8(offset8, (256 / 3));
+    uint8_t twothirds = scale8(offset8, ((256 * 2) / 3));
+    uint8_t r, g, b;
+
+    switch (hue >> 5) {
+        case 0: r = K255 - third; g = third; b = 0; break;
+        case 1: r = K171; g = K85 + third; b = 0; break;
+        case 2: r = K171 - twothirds; g = K170 + third; b = 0; break;
+        case 3: r = 0; g = K255 - third; b = third; break;
+        case 4: r = 0; g = K171 - twothirds; b = K85 + twothirds; break;
+        case 5: r = third; g = 0; b = K255 - third; break;
+        case 6: r = K85 + third; g = 0; b = K171 - third; break;
+        default: r = K170 + third; g = 0; b = K85 - third; break;
+    }
+
+    if (sat != 255) {
+        if (sat == 0) {
+            r = g = b = 255;
+        }
+        else {
+            uint8_t desat = 255 - sat;
+            desat = scale8_video(desat, desat);
+            uint8_t satscale = 255 - desat;
+            r = scale8(r, satscale) + desat;
+            g = scale8(g, satscale) + desat;
+            b = scale8(b, satscale) + desat;
+        }
+    }
+
+    if (val != 255) {
+        val = scale8_video(val, val);
+        if (val == 0) {
+            r = g = b = 0;
+        }
+        else {
+            if (r) r = scale8(r, val) + 1;
+            if (g) g = scale8(g, val) + 1;
+            if (b) b = scale8(b, val) + 1;
+        }
+    }
+
+    rgb.r = r;
+    rgb.g = g;
+    rgb.b = b;
+}
+
+inline void fill_rainbow(CRGB* leds, int count, uint8_t initialHue, uint8_t deltaHue = 5) {
+    CHSV hsv(initialHue, 240, 255);
+    for (int i = 0; i < count; i++) {
+        leds[i] = hsv;
+        hsv.hue += deltaHue;
+    }
+}
+
+template<uint8_t DATA_PIN> class NEOPIXEL {};
+
+/**
+ * The leds are not sent anywhere, the frames are only counted.
+ * With a transfer time, show() takes that time without using the CPU, like a DMA output, and counts the
+ * frames whose leds changed while they were being sent.
+ */
+class CFastLED {
+public:
+    template<template<uint8_t> class CHIPSET, uint8_t DATA_PIN> void addLeds(CRGB* leds, int count) {
+        _leds = leds;
+        _count = count;
+    }
+
+    void setBrightness(uint8_t) {}
+
+    void show() {
+        if (onShow != NULL)
+            onShow(_leds, _count);
+
+        if (transferMicros != 0) {
+            CRGB* sent = new CRGB[_count];
+            memcpy(sent, _leds, _count * sizeof(CRGB));
+            usleep(transferMicros);
+            if (memcmp(sent, _leds, _count * sizeof(CRGB)) != 0)
+                torn++;
+            delete[] sent;
+        }
+
+        shows++;
+    }
+
+    /**
+     * Frames sent, and frames changed while they were being sent (transferMicros long)
+     */
+    volatile unsigned long shows = 0;
+    volatile unsigned long torn = 0;
+    unsigned long transferMicros = 0;
+
+    /**
+     * Called when a frame starts being sent, with the leds registered by addLeds
+     */
+    void (*onShow)(const CRGB* leds, int count) = NULL;
+
+private:
+    CRGB* _leds = NULL;
+    int _count = 0;
+};
+
+static CFastLED FastLED;
@@ -0,0 +1,107 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * SD card stand-in backed by the files of a directory
+ *
+ * Counts what the real library would do: read calls, and 512-byte blocks loaded from the card
+ * into its cache (one SPI transfer each).
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <string>
+
+#include <Arduino.h>
+
+#define FILE_READ 0
+
+#define SD_BLOCK_SIZE 512
+
+struct SdCounters {
+    unsigned long reads;
+    unsigned long bytes;
+    unsigned long blocks;
+};
+
+class File {
+public:
+    File() : _stream(NULL), _position(0), _cached(-1) {}
+    explicit File(FILE* stream) : _stream(stream), _position(0), _cached(-1) {}
+
+    int read(void* buffer, uint16_t length) {
+        counters.reads++;
+        int read = fread(buffer, 1, length, _stream);
+        if (read <= 0)
+            return -1;
+
+        // The library copies from its block cache, and loads every new block it crosses
+        for (long block = _position / SD_BLOCK_SIZE; block <= (long)(_position + read - 1) / SD_BLOCK_SIZE; block++) {
+            if (block != _cached) {
+                counters.blocks++;
+                _cached = block;
+            }
+        }
+        _position += read;
+        counters.bytes += read;
+        return read;
+    }
+
+    bool seek(uint32_t position) {
+        _position = position;
+        return fseek(_stream, position, SEEK_SET) == 0;
+    }
+
+    void close() {
+        if (_stream)
+            fclose(_stream);
+        _stream = NULL;
+    }
+
+    operator bool() const { return _stream != NULL; }
+
+    static SdCounters counters;
+
+private:
+    FILE* _stream;
+    uint32_t _position;
+    long _cached;
+};
+
+class SDClass {
+public:
+    bool begin(uint8_t) { return true; }
+
+    File open(const char* name, uint8_t = FILE_READ) {
+        return File(fopen((root + "/" + name).c_str(), "rb"));
+    }
+
+    /**
+     * Directory standing for the card
+     */
+    std::string root = ".";
+};
+
+extern SDClass SD;
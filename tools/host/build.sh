@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Builds and runs the host checks and benchmarks of AtmoLight on a PC
+#
+# The programs of this directory include the sketch modules they exercise, with
+# the stand-ins of Arduino.h and FastLED.h found here instead of the real ones.
+#
+# Usage:
+#     tools/host/build.sh              build and run all of them
+#     tools/host/build.sh hue_check    only one
+#
+# The programs are built in tools/host/build. Extra arguments after the name are
+# given to the program. A program with a "Variants:" line in its first comment is
+# built and run once for each compiler flag of the line.
+
+set -e
+
+HOST=$(cd "$(dirname "$0")" && pwd)
+SKETCH=$(cd "$HOST/../.." && pwd)
+mkdir -p "$HOST/build"
+
+run() {
+    name=$1
+    shift
+    echo "== $name"
+
+    # A program can be built several times, with the flags of its "Variants:" line
+    variants=$(sed -n 's|^ \* Variants: ||p' "$HOST/$name.cpp")
+    for flags in ${variants:-""}; do
+        g++ -std=gnu++11 -O2 -Wall -Wno-sign-compare -fsanitize=undefined -fno-sanitize-recover=undefined $flags -I"$HOST" -I"$SKETCH" "$HOST/$name.cpp" -o "$HOST/build/$name" -pthread -lutil
+        "$HOST/build/$name" "$@"
+    done
+}
+
+if [ $# -gt 0 ]; then
+    run "$@"
+else
+    for source in "$HOST"/*.cpp; do
+        run "$(basename "$source" .cpp)"
+    done
+fi
@@ -0,0 +1,166 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Read throughput of the animation clips (ClipReader), from files standing for the SD card
+ *
+ * Decodes every frame of a clip again and again, and prints per frame: the bytes read, the read
+ * calls and the 512-byte blocks the SD library loads from the card. The decoding speed on the PC
+ * is measured; the frame rate on an UNO is estimated from the blocks, the read calls and the bytes
+ * decoded (the SPI transfers of the blocks take most of the time there).
+ *
+ * Usage:
+ *     build.sh clip_bench                  synthetic clips of 90 leds
+ *     build.sh clip_bench <directory>      the CLIPn.ALC files of a directory, made with tools/clip_encode.py
+ *
+ * Options (before the directory): --block-us <time to load a block on the board, default 1300>
+ *                                 --call-us <time of a read call on the board, default 15>
+ *                                 --byte-us <time to decode a byte on the board, default 0.5>
+ */
+
+#include <stdio.h>
+
+#include "config.h"
+#undef LEDS_CLIP
+#define LEDS_CLIP 1
+
+#include <SD.h>
+#include "ClipReader.cpp"
+
+#define BENCH_LEDS 90
+#define BENCH_FRAMES 250
+#define BENCH_PERIOD 40
+
+// Leds decoded at most, the extra leds of a clip are ignored
+#define LEDS_MAX 1024
+
+SDClass SD;
+
+SdCounters File::counters;
+
+/**
+ * Write a clip: every frame is made of runs of "run" leds, "changed" leds out of 256 change at every frame
+ */
+static void writeClip(const char* name, byte run, byte changed) {
+    FILE* file = fopen(name, "wb");
+    byte header[CLIP_HEADER_SIZE] = { 'A', 'L', 'C', CLIP_VERSION,
+        BENCH_LEDS & 0xFF, BENCH_LEDS >> 8, BENCH_PERIOD, 0, BENCH_FRAMES & 0xFF, BENCH_FRAMES >> 8 };
+    fwrite(header, 1, CLIP_HEADER_SIZE, file);
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++) {
+        for (int led = 0; led < BENCH_LEDS; led += run) {
+            byte length = min(run, (byte)(BENCH_LEDS - led));
+
+            if (frame > 0 && random8() >= changed) {
+                fputc(CLIP_OP_SKIP | (length - 1), file);
+            }
+            else if (length > 1 && run > 1) {
+                fputc(CLIP_OP_RUN | (length - 1), file);
+                for (byte c = 0; c < 3; c++)
+                    fputc(random8(), file);
+            }
+            else {
+                fputc(CLIP_OP_LITERAL | (length - 1), file);
+                for (byte i = 0; i < length * 3; i++)
+                    fputc(random8(), file);
+            }
+        }
+    }
+
+    fclose(file);
+}
+
+static void bench(const char* label, byte number, double blockUs, double callUs, double byteUs) {
+    if (!ClipReader::Open(number))
+        return;
+
+    static CRGB leds[LEDS_MAX];
+    unsigned long frames = 0;
+    File::counters = SdCounters();
+
+    unsigned long start = micros();
+    while (micros() - start < 500000) {
+        for (int i = 0; i < 100; i++) {
+            if (!ClipReader::ReadFrame(leds, LEDS_MAX)) {
+                printf("%-12s corrupted clip\n", label);
+                return;
+            }
+            frames++;
+        }
+    }
+    double elapsed = micros() - start;
+
+    double bytes = (double)File::counters.bytes / frames;
+    double reads = (double)File::counters.reads / frames;
+    double blocks = (double)File::counters.blocks / frames;
+    double boardMs = (blocks * blockUs + reads * callUs + bytes * byteUs) / 1000;
+
+    printf("%-12s %9.1f %7.1f %7.2f %10.0f %8.1f %8.2f %7.0f %7.0f\n",
+        label, bytes, reads, blocks, frames / elapsed * 1000000, bytes * frames / elapsed, boardMs,
+        1000 / boardMs, 1000.0 / ClipReader::GetPeriod());
+
+    ClipReader::Close();
+}
+
+int main(int argc, char* argv[]) {
+    double blockUs = 1300, callUs = 15, byteUs = 0.5;
+    int first = 1;
+    for (; first + 1 < argc && argv[first][0] == '-'; first += 2) {
+        if (!strcmp(argv[first], "--block-us"))
+            blockUs = atof(argv[first + 1]);
+        else if (!strcmp(argv[first], "--call-us"))
+            callUs = atof(argv[first + 1]);
+        else if (!strcmp(argv[first], "--byte-us"))
+            byteUs = atof(argv[first + 1]);
+    }
+
+    printf("%-12s %9s %7s %7s %10s %8s %8s %7s %7s\n",
+        "clip", "bytes/fr", "reads", "blocks", "host fps", "MB/s", "uno ms", "uno fps", "clip fps");
+
+    if (first < argc) {
+        SD.root = argv[first];
+        for (byte number = 0; number < CLIP_MAX_NUMBER; number++) {
+            char name[10];
+            strcpy(name, "CLIP0.ALC");
+            name[4] = '0' + number;
+            bench(name, number, blockUs, callUs, byteUs);
+        }
+        return 0;
+    }
+
+    SD.root = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    struct { const char* label; byte run; byte changed; } clips[] = {
+        { "literal", 1, 255 },
+        { "half", 1, 128 },
+        { "runs", 8, 255 },
+        { "still", 8, 16 },
+    };
+    for (auto& clip : clips) {
+        std::string path = SD.root + "/CLIP0.ALC";
+        writeClip(path.c_str(), clip.run, clip.changed);
+        bench(clip.label, 0, blockUs, callUs, byteUs);
+        remove(path.c_str());
+    }
+    return 0;
+}
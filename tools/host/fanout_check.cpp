@@ -0,0 +1,276 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Fan-out of the group addressing (IO_GROUPS) on a fleet of CHECK_NODES devices, against the broker of
+ * Broker.h
+ *
+ * Every device is a process running the Io task (Io.cpp, Mqtt.cpp) with its own MAC address. The check
+ * puts each of them in one or two random groups with the groups= command on its own topic, then targets
+ * the largest group of the fleet in three ways, like tools/fanout_bench.py:
+ *
+ *     device   one publish per member, on lights/<mac>
+ *     group    one publish on lights/group/<n>
+ *     mask     one publish on lights/all, with the mask of the group ("@01")
+ *
+ * The devices scan their socket every IO_SCAN_DELAY, out of phase with each other, and the rounds start at
+ * random times. Every command is a color numbering the round. For each way, prints the messages published and
+ * delivered by the broker, and the fan-out latency: from the first publish to the last member applying
+ * the color (end of Io::_callback). Checks every member applies every command, and no other device does.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <EEPROM.h>
+#include <Ethernet.h>
+#include <FastLED.h>
+
+#include "config.h"
+#undef IO_GROUPS
+#define IO_GROUPS 1
+
+// Each device has the number of its process in its MAC address
+static byte nodeNumber = 0;
+#undef IO_MAC_ADDRESS
+#define IO_MAC_ADDRESS { 0xDE, 0xAD, 0xBE, 0xEF, 0x00, nodeNumber }
+
+#include "Broker.h"
+#include "Mqtt.cpp"
+#include "Text.cpp"
+
+static void nodeCallback(char* topic, byte* payload, unsigned int length);
+
+#define private public
+#include "Display.cpp"
+
+// Io registers its callback on every connection: the one of the check calls it, and times the commands
+#define setCallback(callback) setCallback(nodeCallback)
+#include "Io.cpp"
+#undef setCallback
+#undef private
+
+#define CHECK_NODES 50
+#define CHECK_ROUNDS 20
+
+int analogRead(uint8_t) {
+    return 0;
+}
+
+void Log::Write(LogId id, const void* data, byte length) {}
+
+/**
+ * Written by the devices, read by the check: in memory shared by the processes
+ */
+struct Shared {
+    std::atomic<uint16_t> port;
+
+    struct Node {
+        std::atomic<uint8_t> groups;
+        std::atomic<unsigned long> applied[3 * CHECK_ROUNDS + 1]; // Time each round was applied, 0 if not
+    } nodes[CHECK_NODES];
+};
+
+static Shared* shared;
+
+static void nodeCallback(char* topic, byte* payload, unsigned int length) {
+    CRGB before = Display::_currentColor;
+    Io::_callback(topic, payload, length);
+    unsigned long now = micros();
+
+    Shared::Node& node = shared->nodes[nodeNumber];
+    node.groups = groups;
+
+    CRGB color = Display::_currentColor;
+    uint32_t round = (uint32_t)color.r << 16 | color.g << 8 | color.b;
+    if (color != before && round <= 3 * CHECK_ROUNDS)
+        node.applied[round] = now;
+}
+
+static std::string deviceTopic(byte number) {
+    char topic[24];
+    snprintf(topic, sizeof(topic), "lights/DEADBEEF00%02X", number);
+    return topic;
+}
+
+static unsigned long percentile(std::vector<unsigned long> values, double rank) {
+    std::sort(values.begin(), values.end());
+    return values.empty() ? 0 : values[std::min(values.size() - 1, (size_t)(rank * values.size()))];
+}
+
+int main() {
+    shared = new (mmap(NULL, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)) Shared();
+
+    // The devices, started before the thread of the broker
+    std::vector<pid_t> devices;
+    for (byte number = 0; number < CHECK_NODES; number++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            nodeNumber = number;
+            while (shared->port == 0)
+                usleep(1000);
+
+            // The devices are not powered at the same time
+            usleep(number * IO_SCAN_DELAY * 1000UL / CHECK_NODES);
+            Ethernet.brokerPort = shared->port;
+            Io::Task(NULL);
+        }
+        devices.push_back(pid);
+    }
+
+    Broker broker;
+    shared->port = broker.port();
+
+    auto stop = [&](const char* result) {
+        for (pid_t device : devices) {
+            kill(device, SIGTERM);
+            waitpid(device, NULL, 0);
+        }
+        printf("%s\n", result);
+    };
+
+    EthernetClient socket;
+    Mqtt controller(socket);
+    controller.setServer("127.0.0.1", broker.port());
+    if (!controller.connect("fanout_check")) {
+        stop("the broker refused the connection");
+        return 1;
+    }
+
+    // One or two groups per device, set through MQTT: until every device has its groups
+    byte membership[CHECK_NODES];
+    int sizes[IO_GROUPS_NUMBER] = {};
+    srand(1);
+    for (byte number = 0; number < CHECK_NODES; number++) {
+        membership[number] = 1 << (rand() % IO_GROUPS_NUMBER);
+        if (rand() % 2)
+            membership[number] |= 1 << (rand() % IO_GROUPS_NUMBER);
+        for (byte group = 0; group < IO_GROUPS_NUMBER; group++)
+            sizes[group] += (membership[number] >> group) & 1;
+    }
+
+    byte target = std::max_element(sizes, sizes + IO_GROUPS_NUMBER) - sizes;
+    int members = sizes[target], failures = 0;
+
+    bool ready = false;
+    unsigned long start = millis();
+    while (!ready && millis() - start < 10000) {
+        ready = true;
+        for (byte number = 0; number < CHECK_NODES; number++) {
+            if (shared->nodes[number].groups != membership[number]) {
+                char command[12];
+                snprintf(command, sizeof(command), "groups=%02X", membership[number]);
+                controller.publish(deviceTopic(number).c_str(), command);
+                ready = false;
+            }
+        }
+        usleep(300000);
+    }
+    if (!ready) {
+        stop("the devices didn't take their groups");
+        return 1;
+    }
+
+    printf("%d devices, %d members of the group %d\n\n", CHECK_NODES, members, target);
+    printf("%-8s %9s %9s %7s %7s %7s %7s %7s\n", "way", "published", "delivered", "missed", "wrong", "p50 ms", "p90 ms", "max ms");
+
+    const char* ways[] = { "device", "group", "mask" };
+    uint32_t round = 0;
+    for (byte way = 0; way < 3; way++) {
+        unsigned long published = broker.published, delivered = broker.delivered;
+        unsigned long missed = 0, wrong = 0;
+        std::vector<unsigned long> latencies;
+
+        for (int i = 0; i < CHECK_ROUNDS; i++) {
+            usleep(rand() % (IO_SCAN_DELAY * 1000));
+            round++;
+            char command[16];
+            snprintf(command, sizeof(command), way == 2 ? "#%06X @%02X" : "#%06X", round, 1 << target);
+
+            start = micros();
+            if (way == 0) {
+                for (byte number = 0; number < CHECK_NODES; number++) {
+                    if (membership[number] & (1 << target))
+                        controller.publish(deviceTopic(number).c_str(), command);
+                }
+            }
+            else if (way == 1) {
+                char topic[16];
+                snprintf(topic, sizeof(topic), "lights/group/%d", target);
+                controller.publish(topic, command);
+            }
+            else {
+                controller.publish("lights/all", command);
+            }
+
+            // Every member, or give up after a second
+            int reached = 0;
+            unsigned long last = start;
+            for (unsigned long wait = millis(); millis() - wait < 1000; usleep(1000)) {
+                reached = 0;
+                for (byte number = 0; number < CHECK_NODES; number++) {
+                    unsigned long applied = shared->nodes[number].applied[round];
+                    if (applied != 0 && (membership[number] & (1 << target))) {
+                        reached++;
+                        last = max(last, applied);
+                    }
+                }
+                if (reached == members)
+                    break;
+            }
+
+            missed += members - reached;
+            latencies.push_back((last - start) / 1000);
+        }
+
+        // The last deliveries, then the devices outside of the group
+        usleep(300000);
+        for (uint32_t first = round - CHECK_ROUNDS + 1; first <= round; first++) {
+            for (byte number = 0; number < CHECK_NODES; number++) {
+                if (shared->nodes[number].applied[first] != 0 && !(membership[number] & (1 << target)))
+                    wrong++;
+            }
+        }
+
+        bool ok = missed == 0 && wrong == 0;
+        if (!ok)
+            failures++;
+
+        printf("%-8s %9lu %9lu %7lu %7lu %7lu %7lu %7lu %s\n", ways[way], broker.published - published,
+            broker.delivered - delivered, missed, wrong, percentile(latencies, 0.5), percentile(latencies, 0.9),
+            percentile(latencies, 1), ok ? "ok" : "FAILED");
+    }
+
+    stop(failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,163 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks the way Fire and Aurora dim their wave colors (Display::_updateWaveColors)
+ *
+ * The waves used to be CHSV(hue, 255, v) for every led. They are now converted once at full value and
+ * dimmed with nscale8_video(dim8_video(v)) for every led. hsv2rgb_rainbow squares the value before
+ * scaling the channels, hence the dim8_video. For every hue and every value, prints the largest
+ * difference on a channel with and without dim8_video. Fails if the colors are more than one level apart.
+ *
+ * Then renders frames of Fire and Aurora with Display::_drawFire and _drawAurora, and with the former
+ * code converting both waves for every led. Prints the HSV to RGB conversions and the cycles of this
+ * computer (time stamp counter) per frame, for both. Fails if a channel of a frame is more than two
+ * levels away from the former one (one for each wave).
+ */
+
+#include <stdio.h>
+#include <x86intrin.h>
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <EEPROM.h>
+#include <FastLED.h>
+
+// The modes are driven frame by frame, without the task
+#define private public
+#include "Display.cpp"
+#undef private
+
+#define CHECK_FRAMES 2000
+
+int analogRead(uint8_t) {
+    return 0;
+}
+
+static int difference(const CRGB& a, const CRGB& b) {
+    int result = 0;
+    for (uint8_t c = 0; c < 3; c++)
+        result = max(result, abs(a.raw[c] - b.raw[c]));
+    return result;
+}
+
+/**
+ * Fire, as it was drawn before the wave colors were converted once
+ */
+static void fireFormer(CRGB leds[], unsigned long time) {
+    CHSV color1, color2;
+
+    for (uint16_t i = 0; i < LEDS_NUMBER; i++) {
+        color1 = CHSV(10, 255, 96 * cos(0.003 * time + 0.2 * i - sin(i)) + 159);
+        color2 = CHSV(25, 255, 127 * cos(-0.0085 * time + 3.2 * i + sin(i)) + 127);
+        leds[i] = CRGB(color1) + CRGB(color2);
+    }
+}
+
+/**
+ * Aurora, as it was drawn before the wave colors were converted once.
+ * Reads the first wave of the mode, as updated by the last Display::_drawAurora.
+ */
+static void auroraFormer(CRGB leds[], unsigned long time) {
+    CHSV color1, color2;
+    uint16_t ring = Display::_reg16_a % LEDS_NUMBER;
+
+    for (uint16_t i = 0; i < LEDS_NUMBER; i++) {
+        color1 = CHSV(Display::_reg8_b, 255, auroraWave[ring]);
+        if (++ring == LEDS_NUMBER)
+            ring = 0;
+
+        color2 = CHSV(Display::_reg8_c, 255, 127.0 * cos(-0.001 * time + 0.8 * i + sin(i)) + 127);
+        leds[i] = CRGB(color1) + CRGB(color2);
+    }
+}
+
+/**
+ * Render the frames of a mode both ways, and print what they cost
+ * @return Largest difference between the two on a channel
+ */
+template<typename Draw, typename Former> static int bench(const char* name, Draw draw, Former former) {
+    static CRGB reference[LEDS_NUMBER];
+    unsigned long conversions = 0, formerConversions = 0;
+    unsigned long long cycles = 0, formerCycles = 0;
+    int worst = 0;
+
+    for (unsigned long frame = 0; frame < CHECK_FRAMES; frame++) {
+        unsigned long time = frame * LEDS_DELAY;
+
+        unsigned long before = hsvConversions();
+        unsigned long long start = __rdtsc();
+        draw(time);
+        cycles += __rdtsc() - start;
+        conversions += hsvConversions() - before;
+
+        before = hsvConversions();
+        start = __rdtsc();
+        former(reference, time);
+        formerCycles += __rdtsc() - start;
+        formerConversions += hsvConversions() - before;
+
+        for (uint16_t i = 0; i < LEDS_NUMBER; i++)
+            worst = max(worst, difference(strip[i], reference[i]));
+    }
+
+    printf("%-7s %8.1f %8lu %12.0f %12.0f %12d\n", name, (double)conversions / CHECK_FRAMES, formerConversions / CHECK_FRAMES,
+        (double)cycles / CHECK_FRAMES, (double)formerCycles / CHECK_FRAMES, worst);
+    return worst;
+}
+
+int main() {
+    int worst = 0, worstLinear = 0, exact = 0;
+
+    for (int hue = 0; hue < 256; hue++) {
+        CRGB full = CHSV(hue, 255, 255);
+
+        for (int value = 0; value < 256; value++) {
+            CRGB reference = CHSV(hue, 255, value);
+
+            CRGB dimmed = full;
+            dimmed.nscale8_video(dim8_video(value));
+
+            CRGB linear = full;
+            linear.nscale8_video(value);
+
+            int error = difference(reference, dimmed);
+            worst = max(worst, error);
+            worstLinear = max(worstLinear, difference(reference, linear));
+            if (error == 0)
+                exact++;
+        }
+    }
+
+    printf("nscale8_video(dim8_video(v)): max difference %d, %d/65536 colors exact\n", worst, exact);
+    printf("nscale8_video(v):             max difference %d\n", worstLinear);
+
+    printf("\n%d leds, per frame:\n%-7s %8s %8s %12s %12s %12s\n", LEDS_NUMBER, "mode", "conv.", "former", "cycles", "former", "max diff");
+    Display::Fire();
+    int worstFire = bench("fire", [](unsigned long time) { Display::_drawFire(time); }, fireFormer);
+    Display::Aurora();
+    int worstAurora = bench("aurora", [](unsigned long time) { Display::_drawAurora(time); }, auroraFormer);
+
+    return worst <= 1 && worstFire <= 2 && worstAurora <= 2 ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Load test of the MQTT commands: the Io and Display tasks run on threads, as on the board, against the
+ * broker of Broker.h
+ *
+ * A publisher replays a trace of commands to lights/all and lights/all/color, at the times of the trace.
+ * The Io task (Io.cpp, Mqtt.cpp) reads them through a socket holding 2 KB like the W5100, handles up to
+ * MQTT_LOOP_PACKETS per scan, and applies them to the Display task (Display.cpp), which saves its state to
+ * the EEPROM 5 seconds after the last change. Beyond what the sockets hold, the broker queues up to
+ * CHECK_QUEUE_LIMIT messages for the device, and drops the next ones.
+ *
+ * Prints for every trace: the messages applied per second, dropped by the broker, lost on the way, the
+ * latency from the publish to the end of Io::_callback (on the messages whose payload appears once in
+ * the trace: the synthetic traces number their colors), and the saves of the state. Then reads the
+ * counters of the device with the stats command (IO_STATS), and checks they match the messages handled
+ * and the saves.
+ *
+ * Synthetic traces: a steady flow, a storm of a rule engine, a burst. Or a trace file given after the
+ * name, one message per line, as for tools/mqtt_load.py:
+ *     <time in ms> <topic> <payload>
+ *     0 lights/all/color #ff0000
+ *     5 lights/all on
+ *
+ * Usage:
+ *     build.sh io_load
+ *     build.sh io_load storm.txt
+ */
+
+#include <stdio.h>
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <EEPROM.h>
+#include <Ethernet.h>
+#include <FastLED.h>
+
+#include "config.h"
+#undef IO_STATS
+#define IO_STATS 1
+
+#include "Broker.h"
+#include "Mqtt.cpp"
+#include "Text.cpp"
+
+static void loadCallback(char* topic, byte* payload, unsigned int length);
+
+#define private public
+#include "Display.cpp"
+
+// Io registers its callback on every connection: the one of the check calls it, and times the commands
+#define setCallback(callback) setCallback(loadCallback)
+#include "Io.cpp"
+#undef setCallback
+#undef private
+
+#define CHECK_QUEUE_LIMIT 1000
+
+int analogRead(uint8_t) {
+    return 0;
+}
+
+void Log::Write(LogId id, const void* data, byte length) {}
+
+struct Message {
+    unsigned long time; // in milliseconds from the start of the trace
+    std::string topic;
+    std::string payload;
+};
+
+static std::mutex timesMutex;
+static std::map<std::string, size_t> timed; // Messages of the trace timed, by topic and payload
+static std::vector<unsigned long> sentAt;
+static std::vector<unsigned long> appliedAt;
+static unsigned long handled = 0; // Messages handled by Io::_callback, on any topic
+static unsigned long applied = 0; // Messages of the current trace handled
+
+static void loadCallback(char* topic, byte* payload, unsigned int length) {
+    // The callback cuts the options off the payload
+    std::string key = std::string(topic) + " " + (char*)payload;
+    Io::_callback(topic, payload, length);
+    unsigned long now = micros();
+
+    std::lock_guard<std::mutex> lock(timesMutex);
+    handled++;
+    if (key.compare(0, 11, "lights/all ") == 0 || key.compare(0, 17, "lights/all/color ") == 0)
+        applied++;
+
+    auto found = timed.find(key);
+    if (found != timed.end())
+        appliedAt[found->second] = now;
+}
+
+/**
+ * Colors sent at a steady rate, every fifth message switching the lights on
+ * @param rate Messages per second
+ */
+static std::vector<Message> synthetic(unsigned long count, unsigned long rate, unsigned long& color) {
+    std::vector<Message> trace;
+    for (unsigned long i = 0; i < count; i++) {
+        unsigned long time = rate > 0 ? i * 1000 / rate : 0;
+        if (i % 5 == 4) {
+            trace.push_back(Message{ time, "lights/all", "on" });
+        }
+        else {
+            char payload[8];
+            snprintf(payload, sizeof(payload), "#%06lx", color++ & 0xFFFFFF);
+            trace.push_back(Message{ time, "lights/all/color", payload });
+        }
+    }
+    return trace;
+}
+
+static std::vector<Message> load(const char* path) {
+    std::vector<Message> trace;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        Message message;
+        if (!(fields >> message.time >> message.topic))
+            continue;
+        std::getline(fields >> std::ws, message.payload);
+        trace.push_back(message);
+    }
+    return trace;
+}
+
+static unsigned long percentile(const std::vector<unsigned long>& sorted, double rank) {
+    return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, (size_t)(rank * sorted.size()))];
+}
+
+static int failures = 0;
+
+/**
+ * Publish the trace, and wait for the device to handle it and save its state
+ */
+static void replay(const char* name, const std::vector<Message>& trace, Mqtt& publisher, Broker& broker) {
+    std::map<std::string, int> occurrences;
+    for (const Message& message : trace)
+        occurrences[message.topic + " " + message.payload]++;
+
+    {
+        std::lock_guard<std::mutex> lock(timesMutex);
+        timed.clear();
+        for (size_t i = 0; i < trace.size(); i++) {
+            std::string key = trace[i].topic + " " + trace[i].payload;
+            if (occurrences[key] == 1)
+                timed[key] = i;
+        }
+        sentAt.assign(trace.size(), 0);
+        appliedAt.assign(trace.size(), 0);
+        applied = 0;
+    }
+
+    unsigned long dropped = broker.dropped, saves = Display::GetSaveCount();
+    unsigned long start = micros();
+    for (size_t i = 0; i < trace.size(); i++) {
+        long wait = (long)(start + trace[i].time * 1000 - micros());
+        if (wait > 0)
+            usleep(wait);
+
+        sentAt[i] = micros();
+        publisher.publish(trace[i].topic.c_str(), trace[i].payload.c_str());
+    }
+
+    // Until everything is handled or dropped, or nothing moves for a while
+    unsigned long last = 0, progress = millis();
+    for (;;) {
+        unsigned long done;
+        {
+            std::lock_guard<std::mutex> lock(timesMutex);
+            done = applied;
+        }
+        if (done + broker.dropped - dropped >= trace.size() || millis() - progress > 3000)
+            break;
+        if (done != last) {
+            last = done;
+            progress = millis();
+        }
+        usleep(10000);
+    }
+
+    std::vector<unsigned long> latencies;
+    unsigned long end = start;
+    {
+        std::lock_guard<std::mutex> lock(timesMutex);
+        for (size_t i = 0; i < trace.size(); i++) {
+            if (appliedAt[i] != 0) {
+                latencies.push_back((appliedAt[i] - sentAt[i]) / 1000);
+                end = max(end, appliedAt[i]);
+            }
+        }
+        last = applied;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    // The state is saved once the commands stop
+    usleep((5000 + 2 * LEDS_DELAY) * 1000UL);
+
+    dropped = broker.dropped - dropped;
+    unsigned long lost = trace.size() - last - dropped;
+    if (lost > 0)
+        failures++;
+
+    printf("%-16s %6zu %7lu %7lu %5lu %7.1f %7lu %7lu %7lu %7lu %5lu %s\n", name, trace.size(), last, dropped, lost,
+        last * 1000000.0 / max(end - start, 1UL), percentile(latencies, 0.5), percentile(latencies, 0.9),
+        percentile(latencies, 0.99), percentile(latencies, 1), Display::GetSaveCount() - saves, lost > 0 ? "FAILED" : "ok");
+}
+
+int main(int argc, char* argv[]) {
+    Broker broker(CHECK_QUEUE_LIMIT);
+    Ethernet.brokerPort = broker.port();
+
+    std::thread(Display::Task, (void*)NULL).detach();
+    std::thread(Io::Task, (void*)NULL).detach();
+
+    EthernetClient socket;
+    Mqtt publisher(socket);
+    publisher.setServer("127.0.0.1", broker.port());
+    if (!publisher.connect("io_load"))
+        return 1;
+
+    // The stats are longer than the payloads the client keeps: read at the broker
+    std::mutex statsMutex;
+    std::string stats;
+    broker.onPublish = [&](const std::string& topic, const std::string& payload) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        if (topic == "lights/stats")
+            stats = payload;
+    };
+
+    // The device subscribes once connected
+    unsigned long start = millis();
+    while (!mqtt.connected() && millis() - start < 5000)
+        usleep(10000);
+    usleep(200000);
+    if (!mqtt.connected()) {
+        printf("the device didn't connect\n");
+        return 1;
+    }
+
+    printf("at most %d messages every %d ms: %d messages/s\n\n", MQTT_LOOP_PACKETS, IO_SCAN_DELAY,
+        MQTT_LOOP_PACKETS * 1000 / IO_SCAN_DELAY);
+    printf("%-16s %6s %7s %7s %5s %7s %7s %7s %7s %7s %5s\n", "trace", "sent", "applied", "dropped", "lost",
+        "msg/s", "p50 ms", "p90 ms", "p99 ms", "max ms", "saves");
+
+    if (argc >= 2) {
+        replay(argv[1], load(argv[1]), publisher, broker);
+    }
+    else {
+        unsigned long color = 1;
+        replay("steady 20/s", synthetic(60, 20, color), publisher, broker);
+        replay("storm 200/s", synthetic(400, 200, color), publisher, broker);
+        replay("burst 100", synthetic(100, 0, color), publisher, broker);
+    }
+
+    // The counters of the device
+    publisher.publish("lights/all", "stats");
+    start = millis();
+    for (bool answered = false; !answered && millis() - start < 2000; usleep(10000)) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        answered = !stats.empty();
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    unsigned long rx = 0, bad = 0, saves = 0;
+    const char* counters = strchr(stats.c_str(), ' ');
+    bool ok = counters != NULL && sscanf(counters, " rx=%lu bad=%lu saves=%lu", &rx, &bad, &saves) == 3;
+    {
+        std::lock_guard<std::mutex> lock(timesMutex);
+        ok = ok && rx == handled && saves == Display::GetSaveCount();
+    }
+    printf("\nstats: %s %s\n", stats.c_str(), ok ? "ok" : "FAILED");
+    if (!ok)
+        failures++;
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+
+    // The tasks never return: leave without waiting for them
+    fflush(stdout);
+    _exit(failures ? 1 : 0);
+}
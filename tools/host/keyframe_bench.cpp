@@ -0,0 +1,126 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Visual error and speedup of the keyframes (LEDS_KEYFRAMES, Display::_drawKeyframes)
+ *
+ * Renders 20 s of Fire and Aurora frame after frame, every LEDS_DELAY, with the keyframes blended as the
+ * Display task does, and again with every frame fully computed (LEDS_KEYFRAMES 0, Display::_drawKeyframe).
+ * Every frame is compared with the full one channel by channel: prints the mean, 99th percentile and
+ * largest difference, and the time per frame of both on this computer.
+ *
+ * Built once per number of frames between two keyframes, given in the variants below.
+ * Variants: -DCHECK_KEYFRAMES=2 -DCHECK_KEYFRAMES=3 -DCHECK_KEYFRAMES=4 -DCHECK_KEYFRAMES=8
+ */
+
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <EEPROM.h>
+#include <FastLED.h>
+
+#include "config.h"
+#ifndef CHECK_KEYFRAMES
+    #define CHECK_KEYFRAMES 4
+#endif
+#undef LEDS_KEYFRAMES
+#define LEDS_KEYFRAMES CHECK_KEYFRAMES
+
+// The modes are drawn frame by frame, without the task
+#define private public
+#include "Display.cpp"
+#undef private
+
+#define CHECK_FRAMES (20000 / LEDS_DELAY)
+
+int analogRead(uint8_t) {
+    return 0;
+}
+
+/**
+ * Render the frames, at the time of each, and keep them
+ * @return Time per frame, in microseconds
+ */
+template<typename Draw> static double render(void (*mode)(), Draw draw, std::vector<CRGB>& frames) {
+    double elapsed = 0;
+
+    timeShift() = 0;
+    mode();
+    frames.resize(CHECK_FRAMES * LEDS_NUMBER);
+
+    for (unsigned long frame = 0; frame < CHECK_FRAMES; frame++) {
+        timeShift() = frame * LEDS_DELAY * 1000UL;
+
+        auto start = std::chrono::steady_clock::now();
+        draw();
+        elapsed += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        memcpy(&frames[frame * LEDS_NUMBER], strip, sizeof(strip));
+    }
+
+    return elapsed / CHECK_FRAMES;
+}
+
+static void bench(const char* name, void (*mode)()) {
+    std::vector<CRGB> full, blended;
+    double fullTime = render(mode, []() { Display::_drawKeyframe(millis()); }, full);
+    double blendedTime = render(mode, []() { Display::_drawKeyframes(); }, blended);
+
+    // Number of channels per difference
+    unsigned long histogram[256] = { 0 };
+    for (size_t i = 0; i < full.size(); i++) {
+        for (uint8_t c = 0; c < 3; c++)
+            histogram[abs(full[i].raw[c] - blended[i].raw[c])]++;
+    }
+
+    unsigned long channels = full.size() * 3, count = 0, sum = 0;
+    int p99 = -1, worst = 0;
+    for (int difference = 0; difference < 256; difference++) {
+        count += histogram[difference];
+        sum += histogram[difference] * difference;
+        if (p99 < 0 && count >= channels * 99 / 100)
+            p99 = difference;
+        if (histogram[difference])
+            worst = difference;
+    }
+
+    printf("%-7s %9d %6.2f %6d %6d %10.2f %10.2f %7.1fx\n",
+        name, LEDS_KEYFRAMES, (double)sum / channels, p99, worst, fullTime, blendedTime, fullTime / blendedTime);
+}
+
+int main() {
+    clockStopped() = true;
+
+    if (LEDS_KEYFRAMES == 2)
+        printf("%d leds, a frame every %d ms\n%-7s %9s %6s %6s %6s %10s %10s %8s\n", LEDS_NUMBER, LEDS_DELAY,
+            "mode", "keyframes", "mean", "p99", "max", "full us", "blend us", "speedup");
+
+    bench("fire", Display::Fire);
+    bench("aurora", Display::Aurora);
+    return 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks the XY table of the matrix (Matrix.h), and times it against computing the index of every pixel
+ *
+ * For the layout given in CHECK_LAYOUT (width, height, serpentine, rotation, mirror x, mirror y, as on
+ * config.h), checks MatrixXY::values holds every led of the strip once, and that each pixel is the one
+ * found by walking the wiring back: the led's row and column on the wiring, rotated counterclockwise and
+ * mirrored, must give the pixel's position.
+ *
+ * Then sends frames to the strip through the table and through Matrix::Map computed at run time, and
+ * renders frames of Fire and Aurora in 2D to compare with the whole frame. Times are on this computer.
+ *
+ * Built once per layout, given in the variants below.
+ * Variants: -DCHECK_LAYOUT=(16,16,1,0,0,0) -DCHECK_LAYOUT=(16,16,0,90,1,0) -DCHECK_LAYOUT=(16,16,1,180,0,1) -DCHECK_LAYOUT=(16,16,1,270,1,1) -DCHECK_LAYOUT=(32,8,1,0,0,0) -DCHECK_LAYOUT=(32,8,0,90,0,0) -DCHECK_LAYOUT=(32,8,1,180,1,0) -DCHECK_LAYOUT=(32,8,1,270,0,1)
+ */
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <EEPROM.h>
+#include <FastLED.h>
+
+#ifndef CHECK_LAYOUT
+    #define CHECK_LAYOUT (16,16,1,0,0,0)
+#endif
+
+#define LAYOUT(field, layout) field layout
+#define LAYOUT_WIDTH(width, height, serpentine, rotation, mirrorX, mirrorY) width
+#define LAYOUT_HEIGHT(width, height, serpentine, rotation, mirrorX, mirrorY) height
+#define LAYOUT_SERPENTINE(width, height, serpentine, rotation, mirrorX, mirrorY) serpentine
+#define LAYOUT_ROTATION(width, height, serpentine, rotation, mirrorX, mirrorY) rotation
+#define LAYOUT_MIRROR_X(width, height, serpentine, rotation, mirrorX, mirrorY) mirrorX
+#define LAYOUT_MIRROR_Y(width, height, serpentine, rotation, mirrorX, mirrorY) mirrorY
+
+#include "config.h"
+#undef LEDS_NUMBER
+#undef LEDS_MATRIX
+#undef LEDS_MATRIX_WIDTH
+#undef LEDS_MATRIX_HEIGHT
+#undef LEDS_MATRIX_SERPENTINE
+#undef LEDS_MATRIX_ROTATION
+#undef LEDS_MATRIX_MIRROR_X
+#undef LEDS_MATRIX_MIRROR_Y
+#define LEDS_MATRIX 1
+#define LEDS_MATRIX_WIDTH LAYOUT(LAYOUT_WIDTH, CHECK_LAYOUT)
+#define LEDS_MATRIX_HEIGHT LAYOUT(LAYOUT_HEIGHT, CHECK_LAYOUT)
+#define LEDS_MATRIX_SERPENTINE LAYOUT(LAYOUT_SERPENTINE, CHECK_LAYOUT)
+#define LEDS_MATRIX_ROTATION LAYOUT(LAYOUT_ROTATION, CHECK_LAYOUT)
+#define LEDS_MATRIX_MIRROR_X LAYOUT(LAYOUT_MIRROR_X, CHECK_LAYOUT)
+#define LEDS_MATRIX_MIRROR_Y LAYOUT(LAYOUT_MIRROR_Y, CHECK_LAYOUT)
+#define LEDS_NUMBER (LEDS_MATRIX_WIDTH * LEDS_MATRIX_HEIGHT)
+
+// The modes are drawn frame by frame, without the task
+#define private public
+#include "Display.cpp"
+#undef private
+
+#define CHECK_FRAMES 2000
+
+int analogRead(uint8_t) {
+    return 0;
+}
+
+/**
+ * Position (x, y) of a led once the matrix is hung, found from the wiring
+ */
+static void position(uint16_t led, uint16_t* x, uint16_t* y) {
+    // Row and column on the wiring
+    uint16_t row = led / LEDS_MATRIX_WIDTH;
+    uint16_t column = led % LEDS_MATRIX_WIDTH;
+    if (LEDS_MATRIX_SERPENTINE && (row & 1))
+        column = LEDS_MATRIX_WIDTH - 1 - column;
+
+    // Turned counterclockwise, a quarter at a time
+    for (uint16_t turn = 0; turn < LEDS_MATRIX_ROTATION; turn += 90) {
+        uint16_t turned = row;
+        row = column;
+        column = (turn / 90 % 2 == 0 ? LEDS_MATRIX_HEIGHT : LEDS_MATRIX_WIDTH) - 1 - turned;
+    }
+
+    *x = LEDS_MATRIX_MIRROR_X ? MATRIX_WIDTH - 1 - column : column;
+    *y = LEDS_MATRIX_MIRROR_Y ? MATRIX_HEIGHT - 1 - row : row;
+}
+
+/**
+ * Time per frame of draw, in microseconds
+ */
+template<typename Draw> static double measure(Draw draw) {
+    unsigned long start = micros();
+    for (unsigned long frame = 0; frame < CHECK_FRAMES; frame++)
+        draw(frame * LEDS_DELAY);
+    return (double)(micros() - start) / CHECK_FRAMES;
+}
+
+int main() {
+    static CRGB frame[LEDS_NUMBER];
+    static uint8_t seen[LEDS_NUMBER];
+    int failures = 0;
+
+    for (uint16_t pixel = 0; pixel < LEDS_NUMBER; pixel++) {
+        uint16_t led = Matrix::Index(pixel), x, y;
+        if (led >= LEDS_NUMBER || seen[led]++) {
+            failures++;
+            continue;
+        }
+
+        position(led, &x, &y);
+        if (x != pixel % MATRIX_WIDTH || y != pixel / MATRIX_WIDTH)
+            failures++;
+    }
+
+    for (uint16_t i = 0; i < LEDS_NUMBER; i++)
+        frame[i] = CRGB(i, i >> 8, 0);
+
+    double table = measure([](unsigned long) {
+        for (uint16_t pixel = 0; pixel < LEDS_NUMBER; pixel++)
+            strip[Matrix::Index(pixel)] = frame[pixel];
+    });
+
+    // The pixel is only known at run time here, so is the index
+    volatile uint16_t first = 0;
+    double naive = measure([&](unsigned long) {
+        for (uint16_t pixel = first; pixel < LEDS_NUMBER; pixel++)
+            strip[Matrix::Map(pixel)] = frame[pixel];
+    });
+
+    Display::Fire();
+    double fire = measure([](unsigned long time) { Display::_drawFire2D(time); });
+    Display::Aurora();
+    double aurora = measure([](unsigned long time) { Display::_drawAurora2D(time); });
+
+    printf("%2dx%-2d serpentine %d rotation %3d mirror %d%d  %s  us/frame: table %5.2f, computed %5.2f, fire %6.2f, aurora %6.2f\n",
+        LEDS_MATRIX_WIDTH, LEDS_MATRIX_HEIGHT, LEDS_MATRIX_SERPENTINE, LEDS_MATRIX_ROTATION, LEDS_MATRIX_MIRROR_X, LEDS_MATRIX_MIRROR_Y,
+        failures ? "FAILED" : "ok", table, naive, fire, aurora);
+    return failures ? 1 : 0;
+}
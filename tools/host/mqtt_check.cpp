@@ -0,0 +1,185 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks the MQTT client (Mqtt.cpp) against a broker, over TCP
+ *
+ * Runs connect, subscribe, publish, a large publish, ping, unsubscribe and disconnect, checks the
+ * messages come back, and counts the socket writes of every packet: on the Ethernet shield each
+ * write is one SEND command of the W5100, so every packet should go out in one write.
+ * Checks a burst of messages is handled MQTT_LOOP_PACKETS at a time by loop().
+ * Then publishes messages to itself, one at a time, and prints the round trips per second.
+ *
+ * Usage:
+ *     build.sh mqtt_check                          with a minimal broker started by the check
+ *     build.sh mqtt_check 127.0.0.1 1883           with another broker, e.g. mosquitto
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <Ethernet.h>
+
+#include "Broker.h"
+#include "Mqtt.cpp"
+
+#define CHECK_ROUNDS 2000
+
+static const char t_check_progmem[] PROGMEM = "atmolight/check/progmem";
+
+static std::string received;
+static unsigned int receivedLength = 0;
+static unsigned long messages = 0;
+
+static void callback(char* topic, byte* payload, unsigned int length) {
+    received = std::string(topic) + " " + (char*)payload;
+    receivedLength = length;
+    messages++;
+}
+
+static int failures = 0;
+
+static void expect(const char* step, unsigned long writes, unsigned long expected, bool ok) {
+    printf("%-24s %6lu %8s\n", step, writes, ok && writes == expected ? "ok" : "FAILED");
+    if (!ok || writes != expected)
+        failures++;
+}
+
+/**
+ * Call loop until a message is received
+ */
+static bool wait(Mqtt& mqtt) {
+    unsigned long before = messages;
+    unsigned long start = millis();
+    while (messages == before) {
+        if (!mqtt.loop() || millis() - start > 2000)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::string host = "127.0.0.1";
+    uint16_t port = 0;
+    Broker* broker = NULL;
+
+    if (argc >= 3) {
+        host = argv[1];
+        port = atoi(argv[2]);
+    }
+    else {
+        broker = new Broker();
+        port = broker->port();
+    }
+
+    EthernetClient client;
+    Mqtt mqtt(client);
+    mqtt.setServer(host.c_str(), port);
+    mqtt.setCallback(callback);
+
+    printf("broker %s:%d\n\n%-24s %6s %8s\n", host.c_str(), port, "packet", "writes", "");
+    unsigned long writes = client.writes;
+    auto step = [&]() {
+        unsigned long count = client.writes - writes;
+        writes = client.writes;
+        return count;
+    };
+
+    bool ok = mqtt.connect("light_check");
+    expect("connect", step(), 1, ok);
+    if (!ok)
+        return 1;
+
+    std::string topic = "atmolight/check/" + std::to_string(getpid());
+    ok = mqtt.subscribe(topic.c_str());
+    expect("subscribe", step(), 1, ok);
+
+    ok = mqtt.subscribe_P(t_check_progmem);
+    expect("subscribe_P", step(), 1, ok);
+
+    ok = mqtt.publish(topic.c_str(), "#ff0000 42 @05") && wait(mqtt) && received == topic + " #ff0000 42 @05";
+    expect("publish", step(), 1, ok);
+
+    ok = mqtt.publish_P(t_check_progmem, "mode 3") && wait(mqtt) && received == std::string(t_check_progmem) + " mode 3";
+    expect("publish_P", step(), 1, ok);
+
+    // Larger than the packet buffer: goes out in two writes, and must still come back whole
+    std::string large(MQTT_PACKET_SIZE, 'x');
+    ok = mqtt.publish(topic.c_str(), large.c_str()) && wait(mqtt) && receivedLength == large.size();
+    expect("publish (large)", step(), 2, ok);
+
+    // Move the time forward: the line has been quiet for too long, a ping is sent
+    timeShift() += MQTT_KEEPALIVE * 1000000UL;
+    ok = mqtt.loop();
+    expect("pingreq", step(), 1, ok);
+
+    // Once the answer is read, the next ping is sent instead of giving up on the broker
+    unsigned long start = millis();
+    while (millis() - start < 100)
+        mqtt.loop();
+    timeShift() += MQTT_KEEPALIVE * 1000000UL;
+    ok = mqtt.loop();
+    expect("pingresp, pingreq", step(), 1, ok);
+
+    ok = mqtt.unsubscribe_P(t_check_progmem);
+    expect("unsubscribe_P", step(), 1, ok);
+
+    // A burst of messages is handled a few at a time, so the caller gets back to its other duties
+    const int burst = 3 * MQTT_LOOP_PACKETS + 1;
+    usleep(100000);
+    mqtt.loop(); // UNSUBACK
+    for (int i = 0; i < burst; i++)
+        mqtt.publish(topic.c_str(), "mode");
+    step();
+    usleep(100000);
+    unsigned long before = messages;
+    ok = mqtt.loop() && messages - before == MQTT_LOOP_PACKETS;
+    start = millis();
+    while (ok && messages - before < burst && millis() - start < 2000)
+        ok = mqtt.loop();
+    expect("burst, capped loop", step(), 0, ok && messages - before == burst);
+
+    // Round trips, one message at a time
+    start = micros();
+    for (int i = 0; i < CHECK_ROUNDS; i++) {
+        if (!mqtt.publish(topic.c_str(), "#00ff00") || !wait(mqtt)) {
+            failures++;
+            break;
+        }
+    }
+    double elapsed = (micros() - start) / 1000000.0;
+    unsigned long roundWrites = step();
+
+    mqtt.disconnect();
+    expect("disconnect", step(), 1, true);
+
+    delete broker;
+
+    printf("\n%d round trips: %.0f messages/s, %.2f writes per publish\n",
+        CHECK_ROUNDS, CHECK_ROUNDS / elapsed, (double)roundWrites / CHECK_ROUNDS);
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Frame rate of the render/output pipeline, with and without double buffering (LEDS_DOUBLE_BUFFER)
+ *
+ * A render loop stands for the Display task: it keeps the CPU busy for the render time while it writes
+ * the strip pixel after pixel, numbering every pixel with the frame, then calls Display::_show. With
+ * double buffering, Output::Task runs on a second thread with the semaphores of semphr.h. FastLED.show()
+ * takes the transfer time without the CPU, like a DMA output.
+ *
+ * Checks every frame sent is whole (all its pixels from the same frame, unchanged until the end of the
+ * transfer) and that every frame rendered is sent once and in order. Prints the frames per second
+ * measured and the ones expected: 1 / (render + transfer) one after the other, 1 / max(render, transfer)
+ * when the render overlaps the transfer.
+ *
+ * Built with and without double buffering, given in the variants below.
+ * Variants: -DCHECK_DOUBLE_BUFFER=0 -DCHECK_DOUBLE_BUFFER=1
+ */
+
+#include <stdio.h>
+
+#include <thread>
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <EEPROM.h>
+#include <FastLED.h>
+
+#include "config.h"
+#ifndef CHECK_DOUBLE_BUFFER
+    #define CHECK_DOUBLE_BUFFER 1
+#endif
+#undef LEDS_DOUBLE_BUFFER
+#define LEDS_DOUBLE_BUFFER CHECK_DOUBLE_BUFFER
+
+#if LEDS_DOUBLE_BUFFER == 1
+    #include "Output.cpp"
+#endif
+
+// The frames are shown without the task
+#define private public
+#include "Display.cpp"
+#undef private
+
+#define CHECK_FRAMES 100
+
+int analogRead(uint8_t) {
+    return 0;
+}
+
+static unsigned long lastFrame = 0;
+static unsigned long mixed = 0;
+static unsigned long outOfOrder = 0;
+static unsigned long dropped = 0;
+
+/**
+ * Every pixel of a frame sent must come from the same frame, the one after the previous frame sent
+ */
+static void onShow(const CRGB* leds, int count) {
+    unsigned long frame = leds[0].r | leds[0].g << 8;
+    for (int i = 1; i < count; i++) {
+        if (leds[i] != leds[0]) {
+            mixed++;
+            break;
+        }
+    }
+
+    if (frame != lastFrame + 1)
+        outOfOrder++;
+    lastFrame = frame;
+}
+
+/**
+ * Render and show CHECK_FRAMES frames
+ * @return Frames per second
+ */
+static double run(unsigned long renderMicros, unsigned long transferMicros) {
+    FastLED.transferMicros = transferMicros;
+    unsigned long shows = FastLED.shows;
+    unsigned long first = lastFrame + 1;
+    unsigned long start = micros();
+
+    for (unsigned long frame = first; frame < first + CHECK_FRAMES; frame++) {
+        unsigned long renderStart = micros();
+        uint16_t written = 0;
+        while (written < LEDS_NUMBER) {
+            unsigned long elapsed = micros() - renderStart;
+            for (; written < LEDS_NUMBER && written * renderMicros <= elapsed * LEDS_NUMBER; written++)
+                strip[written] = CRGB(frame, frame >> 8, 0x5A);
+
+            // The output task has the higher priority, as on the board
+            std::this_thread::yield();
+        }
+        while (micros() - renderStart < renderMicros)
+            std::this_thread::yield();
+
+        Display::_show();
+    }
+
+    // The last frame is out, or lost
+    unsigned long end = micros();
+    while (FastLED.shows - shows < CHECK_FRAMES && micros() - end < 1000000)
+        usleep(100);
+    end = micros();
+    dropped += CHECK_FRAMES - (FastLED.shows - shows);
+
+    return CHECK_FRAMES * 1000000.0 / (end - start);
+}
+
+int main() {
+    // Render and transfer times, in microseconds: 90 and 300 leds (30 us each), a slow render, a slow output
+    const unsigned long cases[][2] = { { 2000, 2700 }, { 8000, 9000 }, { 12000, 5000 }, { 5000, 12000 } };
+    int failures = 0;
+
+    #if LEDS_DOUBLE_BUFFER == 1
+        Output::Init();
+        FastLED.addLeds<NEOPIXEL, LEDS_PIN>(Output::GetFrame(), LEDS_NUMBER);
+        std::thread(Output::Task, (void*)NULL).detach();
+    #else
+        FastLED.addLeds<NEOPIXEL, LEDS_PIN>(strip, LEDS_NUMBER);
+    #endif
+    FastLED.onShow = onShow;
+
+    if (LEDS_DOUBLE_BUFFER == 0)
+        printf("%-14s %9s %11s %8s %8s %6s %5s %6s %7s\n", "pipeline", "render us", "transfer us", "fps", "expected", "torn", "mixed", "order", "dropped");
+
+    for (const auto& times : cases) {
+        unsigned long torn = FastLED.torn, mixedBefore = mixed, orderBefore = outOfOrder, droppedBefore = dropped;
+        double fps = run(times[0], times[1]);
+        double expected = 1000000.0 / (LEDS_DOUBLE_BUFFER ? max(times[0], times[1]) : times[0] + times[1]);
+
+        torn = FastLED.torn - torn;
+        unsigned long mixedFrames = mixed - mixedBefore, misordered = outOfOrder - orderBefore, lost = dropped - droppedBefore;
+        bool ok = torn == 0 && mixedFrames == 0 && misordered == 0 && lost == 0;
+        if (!ok)
+            failures++;
+
+        printf("%-14s %9lu %11lu %8.1f %8.1f %6lu %5lu %6lu %7lu %s\n", LEDS_DOUBLE_BUFFER ? "double buffer" : "serial",
+            times[0], times[1], fps, expected, torn, mixedFrames, misordered, lost, ok ? "ok" : "FAILED");
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Cost and accuracy of the incremental Rainbow (Display::_drawRainbow)
+ *
+ * Renders the Rainbow mode frame after frame, through several wraps of the hue, and counts the HSV to
+ * RGB conversions of every frame. Each frame is compared with fill_rainbow from the hue of the first
+ * pixel, which used to be computed for every frame.
+ *
+ * Built once per number of leds, given in the variants below.
+ * Variants: -DBENCH_LEDS=10 -DBENCH_LEDS=30 -DBENCH_LEDS=90 -DBENCH_LEDS=150 -DBENCH_LEDS=255 -DBENCH_LEDS=300
+ */
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <EEPROM.h>
+#include <FastLED.h>
+
+#include "config.h"
+#ifdef BENCH_LEDS
+    #undef LEDS_NUMBER
+    #define LEDS_NUMBER BENCH_LEDS
+#endif
+
+// The mode is driven frame by frame, without the task
+#define private public
+#include "Display.cpp"
+#undef private
+
+int analogRead(uint8_t) {
+    return 0;
+}
+
+int main() {
+    static CRGB reference[LEDS_NUMBER];
+
+    // Enough frames for the hue to wrap a few times
+    const unsigned long frames = 3 * 256 * RAINBOW_DELTA + 1000;
+    unsigned long conversions = 0, mismatches = 0;
+
+    Display::Rainbow();
+    unsigned long start = micros();
+    for (unsigned long frame = 0; frame < frames; frame++) {
+        unsigned long before = hsvConversions();
+        Display::_drawRainbow();
+        conversions += hsvConversions() - before;
+    }
+    double elapsed = micros() - start;
+
+    // Once again, comparing every frame
+    Display::Rainbow();
+    for (unsigned long frame = 0; frame < frames; frame++) {
+        Display::_drawRainbow();
+        fill_rainbow(reference, LEDS_NUMBER, Display::_reg8_a, RAINBOW_DELTA);
+        if (memcmp(reference, strip, sizeof(strip)) != 0)
+            mismatches++;
+    }
+
+    // The same frames, rendered with fill_rainbow every time
+    start = micros();
+    for (unsigned long frame = 0; frame < frames; frame++)
+        fill_rainbow(reference, LEDS_NUMBER, frame, RAINBOW_DELTA);
+    double fullElapsed = micros() - start;
+
+    printf("leds %4d  delta %3d  conversions/frame %6.2f (fill_rainbow %4d, %5.0fx fewer)  host %6.2f us/frame (fill_rainbow %6.2f)  frames different from fill_rainbow %lu/%lu\n",
+        LEDS_NUMBER, RAINBOW_DELTA, (double)conversions / frames, LEDS_NUMBER, LEDS_NUMBER * (double)frames / conversions,
+        elapsed / frames, fullElapsed / frames, mismatches, frames);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,252 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks the audio spectrum analyzer (Spectrum.cpp) against a floating point Goertzel filter bank
+ *
+ * Feeds the analyzer with test signals, or with the samples of WAV files (16-bit PCM, resampled to the
+ * 4 kHz of the analyzer), and compares every level with the one computed in double precision from
+ * the same 8-bit samples. The test signals include full scale sines on every band and the input that
+ * drives the filters of the 1.9 kHz band the highest. Then measures the time of an analysis.
+ *
+ * Usage:
+ *     build.sh spectrum_check                   test signals
+ *     build.sh spectrum_check music.wav [...]   and WAV files
+ */
+
+#include <stdio.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Spectrum.cpp"
+
+// Largest difference of level accepted: the filters of the analyzer round down their products
+// (Q14), which leaks a few levels into the bands next to a loud one
+#define CHECK_TOLERANCE 4
+
+#define SAMPLE_RATE (1000000 / SPECTRUM_SAMPLE_PERIOD)
+
+static const int bins[SPECTRUM_BANDS] = { 2, 4, 8, 16, 24, 31 };
+
+static std::vector<int16_t> samples;
+static size_t position = 0;
+
+/**
+ * The microphone: returns the next sample, as the 10-bit ADC would. Reading a sample moves the
+ * clock forward by a sample period, so the analyzer doesn't wait for real time.
+ */
+int analogRead(uint8_t) {
+    int16_t sample = position < samples.size() ? samples[position] : 0;
+    position++;
+    timeShift() += SPECTRUM_SAMPLE_PERIOD;
+    return min(1023, max(0, 512 + sample / 64));
+}
+
+/**
+ * Levels of an analysis starting at the given sample, computed in double precision
+ */
+static void reference(size_t start, uint8_t levels[]) {
+    for (int b = 0; b < SPECTRUM_BANDS; b++) {
+        double coefficient = 2 * cos(2 * M_PI * bins[b] / SPECTRUM_SAMPLES);
+        double s1 = 0, s2 = 0;
+
+        for (int n = 0; n < SPECTRUM_SAMPLES; n++) {
+            size_t i = start + n;
+            int16_t sample = i < samples.size() ? samples[i] : 0;
+            int x = (min(1023, max(0, 512 + sample / 64)) - 512) >> 2;
+
+            double s0 = x + coefficient * s1 - s2;
+            s2 = s1;
+            s1 = s0;
+        }
+
+        double power = max(0.0, s1 * s1 + s2 * s2 - coefficient * s1 * s2);
+        uint8_t level = min(255.0, floor(sqrt(power / 256)));
+        levels[b] = max(level, qsub8(levels[b], SPECTRUM_DECAY));
+    }
+}
+
+/**
+ * Run the analyzer over all the samples and compare it with the reference
+ * @return Largest difference of level
+ */
+static int check(const char* name) {
+    uint8_t expected[SPECTRUM_BANDS] = { 0 };
+    int worst[SPECTRUM_BANDS] = { 0 };
+    int analyses = 0;
+
+    // Start from silence, so the decay of the previous signal doesn't count
+    std::vector<int16_t> signal = samples;
+    samples.assign(SPECTRUM_SAMPLES * 20, 0);
+    position = 0;
+    for (int i = 0; i < 20; i++)
+        Spectrum::Analyze(0);
+    samples = signal;
+    position = 0;
+
+    for (size_t start = 0; start + SPECTRUM_SAMPLES <= samples.size(); start += SPECTRUM_SAMPLES) {
+        Spectrum::Analyze(0);
+        reference(start, expected);
+        for (int b = 0; b < SPECTRUM_BANDS; b++)
+            worst[b] = max(worst[b], abs(Spectrum::GetLevel(b) - expected[b]));
+        analyses++;
+    }
+
+    int result = 0;
+    printf("%-24s %8d", name, analyses);
+    for (int b = 0; b < SPECTRUM_BANDS; b++) {
+        printf(" %6d", worst[b]);
+        result = max(result, worst[b]);
+    }
+    printf("  %s\n", result <= CHECK_TOLERANCE ? "ok" : "FAILED");
+    return result;
+}
+
+static void sine(double frequency, double amplitude, int seconds) {
+    samples.clear();
+    for (int i = 0; i < SAMPLE_RATE * seconds; i++)
+        samples.push_back(amplitude * 32767 * sin(2 * M_PI * frequency * i / SAMPLE_RATE));
+}
+
+/**
+ * The input that gives the highest filter values on the last band: full scale, with the sign of
+ * the impulse response of the filter at the end of the analysis
+ */
+static void worstCase() {
+    double coefficient = 2 * cos(2 * M_PI * bins[SPECTRUM_BANDS - 1] / SPECTRUM_SAMPLES);
+    std::vector<double> response(SPECTRUM_SAMPLES);
+    double s1 = 0, s2 = 0;
+    for (int n = 0; n < SPECTRUM_SAMPLES; n++) {
+        double s0 = (n == 0) + coefficient * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+        response[n] = s0;
+    }
+
+    samples.clear();
+    for (int i = 0; i < 100 * SPECTRUM_SAMPLES; i++)
+        samples.push_back(response[SPECTRUM_SAMPLES - 1 - i % SPECTRUM_SAMPLES] >= 0 ? 32767 : -32768);
+}
+
+/**
+ * Read a 16-bit PCM WAV file, mixed down to mono and resampled to the rate of the analyzer
+ */
+static bool readWav(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + read);
+    fclose(file);
+
+    if (data.size() < 12 || memcmp(&data[0], "RIFF", 4) || memcmp(&data[8], "WAVE", 4))
+        return false;
+
+    auto u16 = [&](size_t i) { return data[i] | data[i + 1] << 8; };
+    auto u32 = [&](size_t i) { return (uint32_t)(u16(i) | u16(i + 2) << 16); };
+
+    int channels = 0, rate = 0, bits = 0;
+    samples.clear();
+    for (size_t chunk = 12; chunk + 8 <= data.size(); chunk += 8 + ((u32(chunk + 4) + 1) & ~1u)) {
+        uint32_t size = u32(chunk + 4);
+        if (!memcmp(&data[chunk], "fmt ", 4) && u16(chunk + 8) == 1) {
+            channels = u16(chunk + 10);
+            rate = u32(chunk + 12);
+            bits = u16(chunk + 22);
+        }
+        else if (!memcmp(&data[chunk], "data", 4) && channels > 0 && bits == 16) {
+            size_t frames = min(size, (uint32_t)(data.size() - chunk - 8)) / (2 * channels);
+            for (size_t out = 0; ; out++) {
+                size_t frame = (size_t)out * rate / SAMPLE_RATE;
+                if (frame >= frames)
+                    break;
+                int sum = 0;
+                for (int c = 0; c < channels; c++)
+                    sum += (int16_t)u16(chunk + 8 + (frame * channels + c) * 2);
+                samples.push_back(sum / channels);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    int worst = 0;
+
+    printf("%-24s %8s", "signal", "analyses");
+    for (int b = 0; b < SPECTRUM_BANDS; b++)
+        printf(" %4.0fHz", bins[b] * (double)SAMPLE_RATE / SPECTRUM_SAMPLES);
+    printf("\n");
+
+    samples.assign(SAMPLE_RATE, 0);
+    worst = max(worst, check("silence"));
+
+    for (int b = 0; b < SPECTRUM_BANDS; b++) {
+        double frequency = bins[b] * (double)SAMPLE_RATE / SPECTRUM_SAMPLES;
+        sine(frequency, 1, 2);
+        worst = max(worst, check(("sine " + std::to_string((int)frequency) + " Hz").c_str()));
+    }
+
+    sine(1900, 1, 2);
+    worst = max(worst, check("sine 1900 Hz (between)"));
+
+    samples.clear();
+    for (int i = 0; i < SAMPLE_RATE * 2; i++)
+        samples.push_back((rand() & 0xFFFF) - 32768);
+    worst = max(worst, check("white noise"));
+
+    worstCase();
+    worst = max(worst, check("worst case 1.9 kHz"));
+
+    for (int i = 1; i < argc; i++) {
+        if (!readWav(argv[i])) {
+            printf("%-24s cannot read a 16-bit PCM WAV file\n", argv[i]);
+            worst = 255;
+            continue;
+        }
+        worst = max(worst, check(argv[i]));
+    }
+
+    // Time of the filters alone: the samples come at once
+    samples.clear();
+    for (int i = 0; i < SPECTRUM_SAMPLES * 20000; i++)
+        samples.push_back((rand() & 0xFFFF) - 32768);
+    position = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 20000; i++)
+        Spectrum::Analyze(0);
+    double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    printf("\nanalysis: %.2f us on this machine, %.1f ns per sample and band\n",
+        elapsed / 20000, elapsed * 1000 / 20000 / SPECTRUM_SAMPLES / SPECTRUM_BANDS);
+
+    printf("%s (tolerance %d)\n", worst <= CHECK_TOLERANCE ? "ok" : "FAILED", CHECK_TOLERANCE);
+    return worst <= CHECK_TOLERANCE ? 0 : 1;
+}
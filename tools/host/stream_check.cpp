@@ -0,0 +1,212 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks the Adalight decoder (SerialStream.cpp) through a pseudo terminal, like the USB serial port
+ *
+ * A thread writes Adalight frames on one side of a pty, the decoder reads the other side byte by byte.
+ * First checks that the frames are decoded whole, across noise, wrong checksums and headers announcing
+ * more leds than a frame can hold. Then streams frames for a few seconds, as fast as the pty takes them
+ * and at the pace of LEDS_SERIAL_BAUD, and prints the frames per second decoded.
+ *
+ * Usage:
+ *     build.sh stream_check [leds] [baud]     default: LEDS_NUMBER and LEDS_SERIAL_BAUD of config.h
+ */
+
+#include <fcntl.h>
+#include <pty.h>
+#include <stdio.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "SerialStream.cpp"
+
+#define CHECK_SECONDS 3
+
+static int master, slave;
+static int failures = 0;
+
+static std::vector<uint8_t> frame(uint16_t leds, uint8_t seed, uint16_t announced) {
+    uint8_t high = announced >> 8, low = announced & 0xFF;
+    std::vector<uint8_t> bytes = { 'A', 'd', 'a', high, low, (uint8_t)(high ^ low ^ 0x55) };
+    for (uint32_t i = 0; i < leds * 3u; i++)
+        bytes.push_back(seed + i * 7);
+    return bytes;
+}
+
+static std::vector<uint8_t> frame(uint16_t leds, uint8_t seed) {
+    return frame(leds, seed, leds - 1);
+}
+
+static void send(const std::vector<uint8_t>& bytes) {
+    size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t written = write(master, bytes.data() + done, bytes.size() - done);
+        if (written > 0)
+            done += written;
+    }
+}
+
+/**
+ * Read and decode bytes until a frame is complete, or nothing comes for a while
+ * @return true if a frame has been decoded
+ */
+static bool receive(CRGB* leds, uint16_t count) {
+    uint8_t buffer[256];
+    auto start = std::chrono::steady_clock::now();
+
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(200)) {
+        ssize_t read = ::read(slave, buffer, 1);
+        if (read <= 0)
+            continue;
+        if (SerialStream::Decode(buffer[0], leds, count))
+            return true;
+    }
+    return false;
+}
+
+static bool matches(const CRGB* leds, uint16_t count, uint8_t seed) {
+    for (uint32_t i = 0; i < count * 3u; i++) {
+        if (((const uint8_t*)leds)[i] != (uint8_t)(seed + i * 7))
+            return false;
+    }
+    return true;
+}
+
+static void expect(const char* name, bool ok) {
+    printf("%-44s %s\n", name, ok ? "ok" : "FAILED");
+    if (!ok)
+        failures++;
+}
+
+/**
+ * Stream frames for CHECK_SECONDS, paced at the given baud rate if not 0
+ * @return Frames decoded per second
+ */
+static double stream(uint16_t leds, long baud) {
+    std::vector<CRGB> strip(leds);
+    std::atomic<bool> running(true);
+    std::atomic<bool> finished(false);
+
+    std::thread writer([&]() {
+        std::vector<uint8_t> bytes = frame(leds, 42);
+        // 10 bits per byte on the line: start, 8 data bits, stop
+        auto period = std::chrono::nanoseconds(baud ? bytes.size() * 10 * 1000000000LL / baud : 0);
+        auto next = std::chrono::steady_clock::now();
+        while (running) {
+            send(bytes);
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+        finished = true;
+    });
+
+    uint8_t buffer[4096];
+    unsigned long frames = 0, bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::seconds(CHECK_SECONDS)) {
+        ssize_t read = ::read(slave, buffer, sizeof(buffer));
+        for (ssize_t i = 0; i < read; i++) {
+            if (SerialStream::Decode(buffer[i], strip.data(), leds))
+                frames++;
+        }
+        bytes += read > 0 ? read : 0;
+    }
+    running = false;
+
+    // Drain the pty until the writer is done (it may be blocked on a full pty), then what is left
+    while (!finished)
+        ::read(slave, buffer, sizeof(buffer));
+    writer.join();
+    while (::read(slave, buffer, sizeof(buffer)) > 0);
+    SerialStream::Reset();
+
+    return (double)frames / CHECK_SECONDS;
+}
+
+int main(int argc, char* argv[]) {
+    uint16_t leds = argc > 1 ? atoi(argv[1]) : LEDS_NUMBER;
+    long baud = argc > 2 ? atol(argv[2]) : LEDS_SERIAL_BAUD;
+
+    if (openpty(&master, &slave, NULL, NULL, NULL) != 0) {
+        perror("openpty");
+        return 1;
+    }
+    termios settings;
+    tcgetattr(slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(slave, TCSANOW, &settings);
+    fcntl(slave, F_SETFL, O_NONBLOCK);
+
+    std::vector<CRGB> strip(leds);
+
+    send(frame(leds, 1));
+    expect("frame", receive(strip.data(), leds) && matches(strip.data(), leds, 1));
+
+    std::vector<uint8_t> noise = { 0x00, 'A', 'd', 'x', 'A', 0xFF, 'A', 'd' };
+    send(noise);
+    send(frame(leds, 2));
+    expect("frame after noise", receive(strip.data(), leds) && matches(strip.data(), leds, 2));
+
+    std::vector<uint8_t> wrong = { 'A', 'd', 'a', 0x00, 0x10, 0x00 };
+    send(wrong);
+    send(frame(leds, 3));
+    expect("frame after a wrong checksum", receive(strip.data(), leds) && matches(strip.data(), leds, 3));
+
+    // The lengths of these frames don't fit in 16 bits: they used to wrap to 0 and 2 bytes
+    for (uint16_t announced : { (uint16_t)0xFFFF, (uint16_t)SERIAL_STREAM_MAX_LEDS }) {
+        std::vector<uint8_t> header = frame(0, 0, announced);
+        send(header);
+        send(frame(leds, 4));
+        bool ok = receive(strip.data(), leds) && matches(strip.data(), leds, 4);
+        char name[64];
+        snprintf(name, sizeof(name), "header of %u leds rejected", announced + 1);
+        expect(name, ok);
+    }
+
+    // More leds than the strip: the extra colors are dropped, the next frame is still found
+    send(frame(leds + 10, 5));
+    send(frame(leds, 6));
+    expect("longer frame, then frame", receive(strip.data(), leds) && matches(strip.data(), leds, 5)
+        && receive(strip.data(), leds) && matches(strip.data(), leds, 6));
+
+    double fastest = stream(leds, 0);
+    double paced = stream(leds, baud);
+    double line = baud / 10.0 / (6 + 3 * leds);
+
+    printf("\n%d leds, %d bytes per frame\n", leds, 6 + 3 * leds);
+    printf("as fast as the pty goes: %.0f frames/s\n", fastest);
+    printf("at %ld bauds: %.1f frames/s (the line allows %.1f)\n", baud, paced, line);
+
+    bool sustained = paced >= line * 0.95;
+    expect("sustained the line rate", sustained);
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,181 @@
+/**
+ * AtmoLight
+ *
+ * Copyright (C) 2016-2020 Pierre Faivre
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Cost of the Program mode (Vm::Render) next to the hand-written Aurora (Display::_drawAurora)
+ *
+ * Renders Aurora, and a program drawing the same two waves, for a few seconds of frames at LEDS_NUMBER
+ * leds. Prints the instructions run and the HSV to RGB conversions of every frame, and the time per
+ * frame on this computer.
+ *
+ * The Arduino can't be timed from here. Instead, the cycles left for every instruction at 25 fps on a
+ * 16 MHz AVR are printed, once the conversions (counted at 200 cycles each, a generous bound) and the
+ * output of the leds (30 us per led, interrupts disabled) are taken out. An 8-bit instruction dispatched
+ * through the jump table of the switch takes a few tens of cycles, Beat and its 32-bit multiplies about
+ * two hundred: the program keeps up as long as the budget stays well above that.
+ *
+ * Then checks the programs refused by the VM are refused, and leave the current one loaded.
+ */
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <EEPROM.h>
+#include <FastLED.h>
+
+#include "config.h"
+
+// The mode is driven frame by frame, without the task
+#define private public
+#include "Vm.cpp"
+#include "Display.cpp"
+#undef private
+
+#define BENCH_FRAMES 2000
+#define BENCH_FPS 25
+#define BENCH_CPU_HZ 16000000UL
+#define BENCH_HSV_CYCLES 200
+#define BENCH_SHOW_US_PER_LED 30
+
+int analogRead(uint8_t) {
+    return 0;
+}
+
+/*
+ * The two waves of Aurora (see tools/vm_asm.py)
+ *     hue         ; hue of the first wave, given by the mode
+ *     push 110    ; hue of the second wave
+ *     index       ; second wave, going backwards: cos8(33 i - t)
+ *     push 33
+ *     mul
+ *     time
+ *     sub
+ *     cos
+ *     blend       ; the hue leans towards the second wave where it is bright
+ *     push 255    ; saturation
+ *     index       ; first wave, going forwards: cos8(4 i + t)
+ *     push 4
+ *     mul
+ *     time
+ *     add
+ *     cos
+ *     dup         ; dimmed like dim8_video
+ *     scale
+ *     index       ; second wave again, dimmed
+ *     push 33
+ *     mul
+ *     time
+ *     sub
+ *     cos
+ *     dup
+ *     scale
+ *     qadd        ; both waves add up
+ */
+static const byte aurora[] = {
+    0x04, 0x01, 0x6e, 0x02, 0x01, 0x21, 0x12, 0x03, 0x11, 0x21, 0x23, 0x01, 0xff, 0x02, 0x01, 0x04,
+    0x12, 0x03, 0x10, 0x21, 0x05, 0x13, 0x02, 0x01, 0x21, 0x12, 0x03, 0x11, 0x21, 0x05, 0x13, 0x14
+};
+
+/**
+ * Number of instructions run for every pixel (the programs have no jump)
+ */
+static unsigned int instructions(const byte* code, unsigned int length) {
+    unsigned int count = 0;
+    for (unsigned int pc = 0; pc < length; pc++, count++) {
+        if ((Op)code[pc] == Op::Push)
+            pc++;
+    }
+    return count;
+}
+
+static int failures = 0;
+
+static void expect(const char* name, bool ok) {
+    printf("%-40s %s\n", name, ok ? "ok" : "FAILED");
+    if (!ok)
+        failures++;
+}
+
+/**
+ * Render BENCH_FRAMES frames, 1000 / BENCH_FPS ms apart
+ * @return Time per frame, in microseconds
+ */
+template<typename Draw> static double render(Draw draw, unsigned long* conversions) {
+    unsigned long before = hsvConversions();
+    unsigned long elapsed = 0;
+
+    for (unsigned long frame = 0; frame < BENCH_FRAMES; frame++) {
+        unsigned long start = micros();
+        draw();
+        elapsed += micros() - start;
+        timeShift() += 1000000UL / BENCH_FPS;
+    }
+
+    *conversions = (hsvConversions() - before) / BENCH_FRAMES;
+    return (double)elapsed / BENCH_FRAMES;
+}
+
+int main() {
+    unsigned long conversions;
+
+    expect("aurora program accepted", Vm::Load(aurora, sizeof(aurora)));
+
+    Display::Aurora();
+    double auroraTime = render([]() { Display::_drawAurora(millis()); }, &conversions);
+    printf("\nleds %d, per frame:\n%-10s %6s %12s %10s %14s\n", LEDS_NUMBER, "", "ops", "conversions", "host us", "AVR cycles/op");
+    printf("%-10s %6s %12lu %10.2f\n", "aurora", "-", conversions, auroraTime);
+
+    double programTime = render([]() { Vm::Render(strip, LEDS_NUMBER, 160); }, &conversions);
+    unsigned long ops = (unsigned long)instructions(aurora, sizeof(aurora)) * LEDS_NUMBER;
+
+    // Cycles of one frame at 25 fps, less the conversions and the output of the leds
+    long budget = BENCH_CPU_HZ / BENCH_FPS - conversions * BENCH_HSV_CYCLES
+        - (BENCH_CPU_HZ / 1000000UL) * BENCH_SHOW_US_PER_LED * LEDS_NUMBER;
+    printf("%-10s %6lu %12lu %10.2f %14ld\n\n", "program", ops, conversions, programTime, budget / (long)ops);
+
+    // Rejected programs, the loaded one must stay
+    const byte underflow[] = { 0x10, 0x01, 0x01, 0x01, 0x02, 0x01, 0x03 };
+    const byte overflow[] = { 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07 };
+    const byte operand[] = { 0x02, 0x02, 0x01 };
+    const byte twoValues[] = { 0x02, 0x03 };
+    const byte fourValues[] = { 0x02, 0x03, 0x04, 0x02 };
+    const byte unknown[] = { 0x02, 0x03, 0x04, 0xFF };
+    byte tooLong[VM_CODE_SIZE + 1];
+    memset(tooLong, (byte)Op::Dup, sizeof(tooLong));
+    tooLong[0] = (byte)Op::Index;
+
+    expect("rejected: stack underflow", !Vm::Load(underflow, sizeof(underflow)));
+    expect("rejected: depth above 8", !Vm::Load(overflow, sizeof(overflow)));
+    expect("rejected: push without its operand", !Vm::Load(operand, sizeof(operand)));
+    expect("rejected: 2 values left", !Vm::Load(twoValues, sizeof(twoValues)));
+    expect("rejected: 4 values left", !Vm::Load(fourValues, sizeof(fourValues)));
+    expect("rejected: unknown instruction", !Vm::Load(unknown, sizeof(unknown)));
+    expect("rejected: empty", !Vm::Load(aurora, 0));
+    expect("rejected: longer than VM_CODE_SIZE", !Vm::Load(tooLong, sizeof(tooLong)));
+    expect("still loaded after the rejections", Vm::IsLoaded() && Vm::_length == sizeof(aurora) && memcmp(Vm::_code, aurora, sizeof(aurora)) == 0);
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
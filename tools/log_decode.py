@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""
+Decoder for the AtmoLight binary logs (see Log.h)
+
+Reads the records sent on the serial port and prints them as text.
+The messages are taken from the LOG_MESSAGES list of Log.h, so the decoder must
+be run against the same version of the sources as the firmware.
+
+Usage:
+    log_decode.py /dev/ttyACM0 [--baud 38400]
+    log_decode.py capture.bin
+
+Reading from a serial port requires pyserial (pip install pyserial).
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+SYNC = 0xA5
+
+MESSAGE_PATTERN = re.compile(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)')
+
+# Size and struct code of the supported conversions (AVR is little endian)
+CONVERSIONS = {"%hhu": (1, "B"), "%u": (2, "H"), "%lu": (4, "I")}
+CONVERSION_PATTERN = re.compile(r"%hhu|%lu|%u|%s")
+
+
+def load_messages(header):
+    """Identifiers are given in the order of the list, starting at 0"""
+    with open(header) as source:
+        text = source.read()
+
+    catalog = text[text.index("#define LOG_MESSAGES"):]
+    catalog = catalog[:catalog.index("\n\n")]
+
+    return [(name, fmt.encode().decode("unicode_escape")) for name, fmt in MESSAGE_PATTERN.findall(catalog)]
+
+
+def format_record(messages, identifier, data):
+    if identifier >= len(messages):
+        return "<unknown message %d: %s>" % (identifier, data.hex())
+
+    _, fmt = messages[identifier]
+    values = []
+    offset = 0
+
+    for conversion in CONVERSION_PATTERN.findall(fmt):
+        if conversion == "%s":
+            # A string is always the last argument and takes the rest of the record
+            values.append(data[offset:].decode(errors="replace"))
+            offset = len(data)
+            continue
+
+        size, code = CONVERSIONS[conversion]
+        if offset + size > len(data):
+            return "<truncated %s: %s>" % (messages[identifier][0], data.hex())
+        values.append(struct.unpack_from("<" + code, data, offset)[0])
+        offset += size
+
+    return CONVERSION_PATTERN.sub(lambda match: "%" + match.group(0)[-1], fmt) % tuple(values)
+
+
+def records(stream):
+    """Yields (identifier, data). Bytes outside of the records are skipped."""
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            return
+        if byte[0] != SYNC:
+            continue
+
+        header = stream.read(2)
+        if len(header) < 2:
+            return
+        data = stream.read(header[1])
+        if len(data) < header[1]:
+            return
+
+        yield header[0], data
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decoder for the AtmoLight binary logs")
+    parser.add_argument("input", help="serial port or capture file")
+    parser.add_argument("--baud", type=int, default=38400, help="baud rate of the serial port")
+    parser.add_argument("--header", default=os.path.join(os.path.dirname(__file__), "..", "Log.h"),
+                        help="Log.h of the firmware")
+    args = parser.parse_args()
+
+    messages = load_messages(args.header)
+
+    if os.path.isfile(args.input):
+        stream = open(args.input, "rb")
+    else:
+        import serial
+        stream = serial.Serial(args.input, args.baud)
+
+    try:
+        for identifier, data in records(stream):
+            print(format_record(messages, identifier, data), flush=True)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""
+Load test for the AtmoLight MQTT commands
+
+Floods a device with commands through the broker, then reports how many of them
+it processed, how many were lost, how long the commands took to be applied and
+how many times the state was saved to the EEPROM.
+
+The device must be built with IO_STATS set to 1 (config.h). Use a single device
+on the broker, as all of them would answer.
+
+Traffic is either synthetic (random colors and on/off at --rate messages per
+second) or replayed from a trace file, one message per line:
+
+    <time in ms> <topic> <payload>
+    0 lights/all/color #ff0000
+    5 lights/all on
+
+The latency is measured with "var" probes: the device publishes its new color
+as soon as it has applied the command.
+
+Usage:
+    mqtt_load.py --host 127.0.0.1 --rate 200 --duration 30
+    mqtt_load.py --host 127.0.0.1 --trace storm.txt
+
+Requires paho-mqtt (pip install paho-mqtt).
+"""
+
+import argparse
+import random
+import re
+import sys
+import threading
+import time
+
+import paho.mqtt.client as paho
+
+T_ALL = "lights/all"
+T_COLOR = "lights/all/color"
+T_STATS = "lights/stats"
+
+STATS_PATTERN = re.compile(r"(\S+) rx=(\d+) bad=(\d+) saves=(\d+)")
+
+
+class Device:
+    """Listens to what the device publishes"""
+
+    def __init__(self, client):
+        self.stats = None
+        self.stats_event = threading.Event()
+        self.probe_sent = None
+        self.probe_event = threading.Event()
+        self.latencies = []
+        self.sent_colors = set()
+        client.on_message = self._on_message
+        client.subscribe([(T_STATS, 0), (T_COLOR, 0)])
+
+    def _on_message(self, client, userdata, message):
+        payload = message.payload.decode(errors="replace")
+
+        if message.topic == T_STATS:
+            match = STATS_PATTERN.match(payload)
+            if match:
+                self.stats = tuple(int(value) for value in match.groups()[1:])
+                self.stats_event.set()
+
+        elif message.topic == T_COLOR and self.probe_sent is not None:
+            # Our own colors come back too, only the device's answer counts
+            if payload not in self.sent_colors:
+                self.latencies.append(time.monotonic() - self.probe_sent)
+                self.probe_sent = None
+                self.probe_event.set()
+
+    def request_stats(self, client, timeout):
+        self.stats_event.clear()
+        client.publish(T_ALL, "stats")
+        if not self.stats_event.wait(timeout):
+            sys.exit("No answer to the stats request. Is the device built with IO_STATS 1?")
+        return self.stats
+
+
+def synthetic_trace(rate, duration):
+    """Random colors, with a few on commands, at a constant rate"""
+    count = int(rate * duration)
+    for i in range(count):
+        if random.random() < 0.9:
+            yield (i / rate, T_COLOR, "#%06x" % random.getrandbits(24))
+        else:
+            yield (i / rate, T_ALL, "on")
+
+
+def file_trace(path):
+    with open(path) as trace:
+        for number, line in enumerate(trace, 1):
+            if not line.strip() or line.startswith("#"):
+                continue
+            try:
+                timestamp, topic, payload = line.split(None, 2)
+                yield (int(timestamp) / 1000.0, topic, payload.rstrip("\n"))
+            except ValueError:
+                sys.exit("%s:%d: expected '<time in ms> <topic> <payload>'" % (path, number))
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Load test for the AtmoLight MQTT commands")
+    parser.add_argument("--host", default="127.0.0.1", help="address of the broker")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--rate", type=float, default=100, help="synthetic messages per second")
+    parser.add_argument("--duration", type=float, default=10, help="synthetic test duration, in seconds")
+    parser.add_argument("--trace", help="replay this trace instead of synthetic traffic")
+    parser.add_argument("--probe-interval", type=float, default=1.0, help="seconds between two latency probes")
+    parser.add_argument("--settle", type=float, default=10.0,
+                        help="seconds to wait after the traffic, for the queued messages and the EEPROM save")
+    args = parser.parse_args()
+
+    # paho-mqtt 2 asks for the callback API version
+    if hasattr(paho, "CallbackAPIVersion"):
+        client = paho.Client(paho.CallbackAPIVersion.VERSION1)
+    else:
+        client = paho.Client()
+    client.connect(args.host, args.port)
+    client.loop_start()
+    device = Device(client)
+    time.sleep(0.5)
+
+    before = device.request_stats(client, 5)
+
+    trace = file_trace(args.trace) if args.trace else synthetic_trace(args.rate, args.duration)
+    sent = 0
+    start = time.monotonic()
+    next_probe = start
+
+    for timestamp, topic, payload in trace:
+        now = time.monotonic()
+        if start + timestamp > now:
+            time.sleep(start + timestamp - now)
+
+        # A probe without answer for 5 s is considered lost
+        if device.probe_sent is not None and time.monotonic() - device.probe_sent > 5:
+            device.probe_sent = None
+
+        # Only one probe at a time, so the answer can't be mistaken
+        if device.probe_sent is None and time.monotonic() >= next_probe:
+            device.probe_sent = time.monotonic()
+            client.publish(T_ALL, "var")
+            sent += 1
+            next_probe += args.probe_interval
+
+        if topic == T_COLOR:
+            device.sent_colors.add(payload)
+        client.publish(topic, payload)
+        sent += 1
+
+    elapsed = time.monotonic() - start
+    device.probe_event.wait(5)
+    time.sleep(args.settle)
+
+    after = device.request_stats(client, 5)
+    client.loop_stop()
+
+    # The second stats request is counted by the device too
+    processed = after[0] - before[0] - 1
+
+    print("Messages sent:      %d in %.1f s (%.0f/s)" % (sent, elapsed, sent / elapsed))
+    print("Messages processed: %d (%.0f/s)" % (processed, processed / elapsed))
+    print("Messages dropped:   %d" % (sent - processed))
+    print("Messages invalid:   %d" % (after[1] - before[1]))
+    print("EEPROM saves:       %d" % (after[2] - before[2]))
+
+    if device.latencies:
+        latencies = [latency * 1000 for latency in device.latencies]
+        print("Apply latency (ms): p50 %.0f, p90 %.0f, p99 %.0f, max %.0f (%d probes)" % (
+            percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99),
+            max(latencies), len(latencies)))
+    else:
+        print("Apply latency:      no probe answered")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+Memory usage report for AtmoLight, per source file
+
+Reads the linked program of an Arduino build and prints, for each source file,
+the flash (text + data) and the SRAM (data + bss) its symbols take, sorted by
+SRAM. The SRAM left for the stacks of the tasks, the heap and the leds is what
+remains after the total.
+
+The objects of the build can't be used for that: the AVR core compiles with
+-flto -fno-fat-lto-objects, so they only hold LTO bytecode. The symbols of the
+linked ELF are attributed to their file with the debug information (avr-nm -l),
+or else to their class for the ones without a line (e.g. "Mqtt::").
+
+Build with arduino-cli, keeping the build directory:
+    arduino-cli compile -b arduino:avr:uno --build-path build .
+
+Then:
+    size_report.py build
+    size_report.py build --compare build-before
+    size_report.py build --symbols 20
+
+Requires avr-nm and avr-size (installed with the AVR core of Arduino, or binutils-avr).
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+# SRAM and flash of the boards AtmoLight runs on, in bytes
+BOARDS = {
+    "uno": (2048, 32256),
+    "mega": (8192, 253952),
+}
+
+# Symbol types of nm: code and PROGMEM constants stay in flash, initialized data is
+# copied from flash to SRAM at startup (so is .rodata on AVR), bss only takes SRAM
+FLASH_TYPES = "TtWwVv"
+DATA_TYPES = "DdRrGg"
+BSS_TYPES = "BbSsCc"
+
+
+def find_elf(build):
+    elves = [name for name in os.listdir(build) if name.endswith(".elf")]
+    if not elves:
+        sys.exit("No linked program (.elf) found in %s" % build)
+    return os.path.join(build, sorted(elves)[0])
+
+
+def owner(name, location):
+    """Source file of a symbol, or its class, or where it comes from"""
+    if location:
+        path = location.rsplit(":", 1)[0]
+        return os.path.basename(path)
+
+    match = re.match(r"(?:\w+::)*?(\w+)::", name)
+    if match:
+        return match.group(1) + "::"
+    return "(no line)"
+
+
+def symbols(elf, nm):
+    """Return [(owner, name, text, data, bss)] for every symbol of the program"""
+    output = subprocess.run([nm, "-S", "--size-sort", "-l", "-C", elf], check=True, capture_output=True, text=True).stdout
+
+    result = []
+    for line in output.splitlines():
+        symbol, _, location = line.partition("\t")
+        fields = symbol.split(None, 3)
+        if len(fields) < 4:
+            continue
+        _, size, kind, name = fields
+        size = int(size, 16)
+
+        text = size if kind in FLASH_TYPES else 0
+        data = size if kind in DATA_TYPES else 0
+        bss = size if kind in BSS_TYPES else 0
+        if text + data + bss:
+            result.append((owner(name, location.strip()), name, text, data, bss))
+    return result
+
+
+def totals(elf, size):
+    """Return (text, data, bss) of the whole program, as the linker placed it"""
+    output = subprocess.run([size, "-A", elf], check=True, capture_output=True, text=True).stdout
+    sections = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[1].isdigit():
+            sections[fields[0]] = int(fields[1])
+    return sections.get(".text", 0), sections.get(".data", 0), sections.get(".bss", 0) + sections.get(".noinit", 0)
+
+
+def per_owner(entries):
+    result = {}
+    for name, _, text, data, bss in entries:
+        values = result.setdefault(name, [0, 0, 0])
+        values[0] += text
+        values[1] += data
+        values[2] += bss
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("build", help="build directory (arduino-cli --build-path)")
+    parser.add_argument("--compare", metavar="BUILD", help="other build directory, to print the differences")
+    parser.add_argument("--board", choices=BOARDS, default="uno")
+    parser.add_argument("--symbols", type=int, default=0, metavar="N", help="also print the N largest symbols in SRAM and in flash")
+    parser.add_argument("--nm", default="avr-nm")
+    parser.add_argument("--size", default="avr-size")
+    args = parser.parse_args()
+
+    elf = find_elf(args.build)
+    entries = symbols(elf, args.nm)
+    current = per_owner(entries)
+    previous = per_owner(symbols(find_elf(args.compare), args.nm)) if args.compare else {}
+
+    print("%-32s %7s %7s" % ("file", "flash", "sram") + ("  %7s %7s" % ("dflash", "dsram") if previous else ""))
+
+    def row(name, text, data, bss, before):
+        line = "%-32s %7d %7d" % (name, text + data, data + bss)
+        if previous:
+            old_text, old_data, old_bss = before
+            line += "  %+7d %+7d" % (text + data - old_text - old_data, data + bss - old_data - old_bss)
+        print(line)
+
+    for name in sorted(set(current) | set(previous), key=lambda n: (-sum(current.get(n, (0, 0, 0))[1:]), -sum(current.get(n, (0, 0, 0))[:2]))):
+        text, data, bss = current.get(name, (0, 0, 0))
+        row(name, text, data, bss, previous.get(name, (0, 0, 0)))
+
+    # The sections also hold what has no symbol (vectors, padding, strings of the core)
+    program = totals(elf, args.size)
+    print()
+    row("total", *program, totals(find_elf(args.compare), args.size) if args.compare else (0, 0, 0))
+
+    sram, flash = BOARDS[args.board]
+    print("free on %s: sram %d, flash %d" % (args.board, sram - program[1] - program[2], flash - program[0] - program[1]))
+
+    if args.symbols:
+        for title, key in (("sram", lambda e: e[3] + e[4]), ("flash", lambda e: e[2] + e[3])):
+            print("\nlargest symbols in %s" % title)
+            for entry in sorted(entries, key=key, reverse=True)[:args.symbols]:
+                if key(entry):
+                    print("  %7d  %-24s %s" % (key(entry), entry[0], entry[1][:60]))
+
+
+if __name__ == "__main__":
+    main()
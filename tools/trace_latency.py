@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+Command-to-light latency breakdown for AtmoLight
+
+Sends traced color commands to a device and prints, for every stage, a histogram
+of the time spent:
+
+    network  publish -> device callback, including the IO_SCAN_DELAY poll
+             (and the way back of the report, measured from this computer)
+    apply    callback -> Display method returned
+    wait     -> first frame of the Display task
+    render   -> FastLED.show() called
+    show     -> FastLED.show() returned
+
+The device must be built with IO_TRACE set to 1 (config.h). Use a single device
+on the broker, as all of them would answer.
+
+Usage:
+    trace_latency.py --host 127.0.0.1 --count 200
+
+Requires paho-mqtt (pip install paho-mqtt).
+"""
+
+import argparse
+import random
+import re
+import threading
+import time
+
+import paho.mqtt.client as paho
+
+T_COLOR = "lights/all/color"
+T_TRACE = "lights/trace"
+
+REPORT_PATTERN = re.compile(r"(\d+) apply=(\d+) wait=(\d+) render=(\d+) show=(\d+)")
+TIMEOUT_PATTERN = re.compile(r"(\d+) timeout")
+
+STAGES = ["network", "apply", "wait", "render", "show", "total"]
+
+
+def histogram(name, values, width=40):
+    values = sorted(values)
+    count = len(values)
+    print("%s (ms): p50 %.1f, p90 %.1f, p99 %.1f, max %.1f" % (
+        name, values[count // 2], values[int(count * 0.9)], values[min(count - 1, int(count * 0.99))], values[-1]))
+
+    low, high = values[0], values[-1]
+    buckets = 10
+    size = (high - low) / buckets or 1
+    counts = [0] * buckets
+    for value in values:
+        counts[min(buckets - 1, int((value - low) / size))] += 1
+
+    for i, bucket in enumerate(counts):
+        bar = "#" * int(round(width * bucket / max(counts)))
+        print("  %8.1f - %8.1f | %-*s %d" % (low + i * size, low + (i + 1) * size, width, bar, bucket))
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Command-to-light latency breakdown for AtmoLight")
+    parser.add_argument("--host", default="127.0.0.1", help="address of the broker")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--count", type=int, default=100, help="number of traced commands")
+    parser.add_argument("--interval", type=float, default=0.5, help="seconds between two commands")
+    args = parser.parse_args()
+
+    sent = {}
+    results = {stage: [] for stage in STAGES}
+    timeouts = []
+    answered = threading.Event()
+
+    def on_message(client, userdata, message):
+        received = time.monotonic()
+        payload = message.payload.decode(errors="replace")
+
+        match = TIMEOUT_PATTERN.fullmatch(payload)
+        if match:
+            timeouts.append(int(match.group(1)))
+            answered.set()
+            return
+
+        match = REPORT_PATTERN.fullmatch(payload)
+        if not match or int(match.group(1)) not in sent:
+            return
+
+        stages = [int(value) / 1000.0 for value in match.groups()[1:]]
+        total = (received - sent.pop(int(match.group(1)))) * 1000
+        for name, value in zip(STAGES[1:5], stages):
+            results[name].append(value)
+        results["network"].append(total - sum(stages))
+        results["total"].append(total)
+        answered.set()
+
+    # paho-mqtt 2 asks for the callback API version
+    if hasattr(paho, "CallbackAPIVersion"):
+        client = paho.Client(paho.CallbackAPIVersion.VERSION1)
+    else:
+        client = paho.Client()
+    client.on_message = on_message
+    client.connect(args.host, args.port)
+    client.subscribe(T_TRACE)
+    client.loop_start()
+    time.sleep(0.5)
+
+    for trace_id in range(1, args.count + 1):
+        answered.clear()
+        # A new color every time, so there is always something to show
+        sent[trace_id] = time.monotonic()
+        client.publish(T_COLOR, "#%06x %d" % (random.getrandbits(24), trace_id))
+        answered.wait(3)
+        time.sleep(args.interval)
+
+    client.loop_stop()
+
+    print("%d commands, %d reports, %d timeouts, %d lost\n" % (
+        args.count, len(results["total"]), len(timeouts), args.count - len(results["total"]) - len(timeouts)))
+
+    for stage in STAGES:
+        if results[stage]:
+            histogram(stage, results[stage])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""
+Assembler for the AtmoLight VM (see Vm.h)
+
+Reads a program in text form, one instruction per line, and writes its bytecode.
+Comments start with ';'. Example (a wave of the mode's hue running along the strip):
+
+    hue
+    push 255
+    index
+    push 25
+    mul
+    time
+    add
+    sin
+
+Usage:
+    vm_asm.py effect.asm effect.bin
+    mosquitto_pub -h <broker> -t lights/all/program -f effect.bin
+"""
+
+import sys
+
+# name: (opcode, values popped, values pushed)
+OPS = {
+    "push":  (0x01, 0, 1),
+    "index": (0x02, 0, 1),
+    "time":  (0x03, 0, 1),
+    "hue":   (0x04, 0, 1),
+    "dup":   (0x05, 1, 2),
+    "swap":  (0x06, 2, 2),
+    "drop":  (0x07, 1, 0),
+    "add":   (0x10, 2, 1),
+    "sub":   (0x11, 2, 1),
+    "mul":   (0x12, 2, 1),
+    "scale": (0x13, 2, 1),
+    "qadd":  (0x14, 2, 1),
+    "qsub":  (0x15, 2, 1),
+    "sin":   (0x20, 1, 1),
+    "cos":   (0x21, 1, 1),
+    "beat":  (0x22, 1, 1),
+    "blend": (0x23, 3, 1),
+}
+
+# Same limits as Vm.h
+CODE_SIZE = 32
+STACK_SIZE = 8
+RESULT_SIZE = 3
+
+
+def assemble(source):
+    code = bytearray()
+    depth = 0
+
+    for number, line in enumerate(source.splitlines(), 1):
+        words = line.split(";")[0].split()
+        if not words:
+            continue
+
+        name = words[0].lower()
+        if name not in OPS:
+            raise ValueError("line %d: unknown instruction '%s'" % (number, name))
+
+        opcode, pop, push = OPS[name]
+        code.append(opcode)
+
+        if name == "push":
+            if len(words) != 2:
+                raise ValueError("line %d: push needs one value" % number)
+            value = int(words[1], 0)
+            if not 0 <= value <= 255:
+                raise ValueError("line %d: value out of range (0 to 255)" % number)
+            code.append(value)
+        elif len(words) != 1:
+            raise ValueError("line %d: '%s' takes no value" % (number, name))
+
+        if depth < pop:
+            raise ValueError("line %d: not enough values on the stack" % number)
+        depth += push - pop
+        if depth > STACK_SIZE:
+            raise ValueError("line %d: stack overflow" % number)
+
+    if len(code) > CODE_SIZE:
+        raise ValueError("program too long (%d bytes, max %d)" % (len(code), CODE_SIZE))
+    if depth != RESULT_SIZE:
+        raise ValueError("the program must leave %d values on the stack (hue, saturation, value), not %d"
+                         % (RESULT_SIZE, depth))
+
+    return bytes(code)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+
+    with open(sys.argv[1]) as source:
+        try:
+            code = assemble(source.read())
+        except ValueError as error:
+            sys.exit("%s: %s" % (sys.argv[1], error))
+
+    with open(sys.argv[2], "wb") as output:
+        output.write(code)
+
+    print("%d bytes: %s" % (len(code), code.hex()))
+
+
+if __name__ == "__main__":
+    main()